@@ -9,23 +9,76 @@
 #ifndef __mc6809_h__
 #define __mc6809_h__
 
+#include <stdint.h>
 #include "usim.h"
 #include "machdep.h"
+#include "mc6809op.h"
 
-class mc6809 : virtual public USimMotorola {
+// Pre-decoded instruction, as captured from its first execution
+struct mc6809_decoded {
+	enum {
+				max_len = 5	// Longest instruction in bytes
+	};
+
+	const void		*op;	// Dispatch table entry
+	Word			ir;	// Opcode, including any prefix
+	Byte			len;	// Length in bytes, 0 if empty
+	Byte			bytes[max_len];
+};
+
+// Register and interrupt state, for saving and restoring a machine
+struct mc6809_state {
+	uint64_t		cycles;	// Cycles since power on
+	Word			pc;
+	Word			u, s;
+	Word			x, y;
+	Word			d, w, v;
+	Byte			dp;
+	Byte			cc;	// Condition codes, evaluated
+	Byte			md;
+	Byte			lines;	// Interrupt lines
+	Byte			waiting;	// Stopped by CWAI or SYNC
+	Byte			nmiarmed;	// NMI enabled once S is loaded
+	Byte			is6309;	// HD6309 instructions enabled
+	Byte			pad;
+};
+
+//
+//	The processor core is parameterised by the class that supplies
+//	its memory bus, which must derive from mc6809_core<Bus> and
+//	provide:
+//
+//		Byte	bus_read(Word);
+//		void	bus_write(Word, Byte);
+//		Byte	*bus_span(Word addr, Word len, int write);
+//
+//	bus_span() returns a host pointer to len bytes at addr if they
+//	are plain memory (and writable if write is set), or 0 otherwise.
+//	Block transfers use it to bypass the byte-wise bus.
+//
+//	Memory accesses are resolved at compile time and can be inlined
+//	into the instruction handlers.  The mc6809 class at the end of
+//	this file provides a bus that goes through the virtual USim
+//	read() and write() functions instead.
+//
+
+template <class Bus>
+class mc6809_core : public USim {
 
 // Processor addressing modes
 protected:
 
-	enum {
-				immediate = 0,
-				relative = 0,
-				inherent,
-				extended,
-				direct,
-				indexed
+	enum addrmode {
+				immediate = mode_immediate,
+				relative = mode_relative,
+				inherent = mode_inherent,
+				extended = mode_extended,
+				direct = mode_direct,
+				indexed = mode_indexed
 	} mode;
 
+	Word			ea;	// Effective address of the last memory operand
+
 // Processor registers
 protected:
 
@@ -47,6 +100,36 @@ protected:
 	Byte&			a;
 	Byte&			b;
 	Word&			d;
+	union {
+		Word			w;	// Combined accumulator (HD6309)
+		struct {
+#ifdef MACH_BYTE_ORDER_MSB_FIRST
+			Byte		e;	// Accumulator e
+			Byte		f;	// Accumulator f
+#else
+			Byte		f;	// Accumulator f
+			Byte		e;	// Accumulator e
+#endif
+		} byte;
+	} accw;
+	Byte&			e;
+	Byte&			f;
+	Word&			w;
+	Word			v;		// Value register (HD6309)
+	Byte			md;		// Mode register (HD6309)
+	Byte			zero;		// Zero register (HD6309)
+
+	enum {
+				md_native = 0x01,	// Native mode
+				md_firq = 0x02,		// FIRQ saves entire state
+				md_illegal = 0x40,	// Illegal instruction trap
+				md_divzero = 0x80	// Division by zero trap
+	};
+
+	DWord			get_q(void) const
+					{ return ((DWord)d << 16) | w; }
+	void			set_q(DWord q)
+					{ d = (Word)(q >> 16); w = (Word)q; }
 	union {
 		Byte			all;	// Condition code register
 		struct {
@@ -72,8 +155,147 @@ protected:
 		} bit;
 	} cc;
 
+// Lazy condition code evaluation
+protected:
+
+	enum {
+				cc_none = 0,	// Condition codes are up to date
+				cc_add8,	// 8 bit add, sets H N Z V C
+				cc_sub8,	// 8 bit subtract, sets N Z V C
+				cc_add16,	// 16 bit add, sets N Z V C
+				cc_sub16,	// 16 bit subtract, sets N Z V C
+				cc_ld8,		// 8 bit load/logic, sets N Z, clears V
+				cc_ld16,	// 16 bit load, sets N Z, clears V
+				cc_inc8,	// 8 bit increment, sets N Z V
+				cc_dec8		// 8 bit decrement, sets N Z V
+	};
+
+	int			lazycc;		// Defer condition code evaluation
+	int			ccop;		// Operation of pending condition codes
+	Word			ccx, ccm;	// and its operands
+	DWord			ccres;		// and result
+
+	static const Byte	ccmask[];	// Flags set by each operation
+
+	void			defer_cc(int, Word, Word, DWord);
+	void			sync_cc(void);
+	Byte			eval_cc(void) const;
+
+public:
+
+	void			lazy_flags(int);	// Switch lazy/eager flags
+	Byte			get_cc(void) const;	// Current condition codes
+
+// Instruction dispatch tables
+protected:
+
+	typedef void		(mc6809_core::*handler)(void);
+
+	int			is6309;		// HD6309 instructions enabled
+
+	struct opcode {
+		handler			fn;	// Instruction handler
+		addrmode		mode;	// Addressing mode
+		Byte			cycles;	// Base cycle count
+	};
+
+	// Indexed by is6309, then by opcode
+	static opcode		optable0[2][256];	// Unprefixed opcodes
+	static opcode		optable10[2][256];	// Prefixed by 0x10
+	static opcode		optable11[2][256];	// Prefixed by 0x11
+
+public:
+
+	void			hd6309(int);		// Enable HD6309 opcodes
+
+// Cycle counting
+protected:
+
+	uint64_t		cycles;		// Cycles since power on
+
+	static const Byte	idxcycles[32];	// Indexed postbyte extras
+
+public:
+
+	uint64_t		get_cycles(void) const { return cycles; }
+	Word			get_pc(void) const { return pc; }
+
+// Saving and restoring
+public:
+
+	typedef mc6809_state	state;
+
+	void			get_state(state&) const;
+	void			set_state(const state&);
+
+// Interrupts
+protected:
+
+	enum {
+				line_nmi = 0x01,	// NMI edge latched
+				line_firq = 0x02,	// FIRQ line asserted
+				line_irq = 0x04		// IRQ line asserted
+	};
+
+	enum {
+				wait_none = 0,
+				wait_cwai,		// Stacked, waiting in CWAI
+				wait_sync		// Waiting in SYNC
+	};
+
+	Byte			lines;		// Interrupt lines
+	Byte			waiting;	// Stopped by CWAI or SYNC
+	int			nmiarmed;	// NMI enabled once S is loaded
+
+	Byte			active_lines(void) const;
+	int			poll_interrupts(void);
+	int			do_interrupt(void);
+
+public:
+
+	// Only to be called from the thread that runs the CPU
+	void			nmi(void);		// Pulse the NMI line
+	void			firq(int);		// Set the FIRQ line
+	void			irq(int);		// Set the IRQ line
+	int			idle(void) const;	// Waiting, nothing pending
+
+// Pre-decoded instructions
+public:
+
+	typedef mc6809_decoded	decoded;
+
+protected:
+
+	bool			capture(decoded&) const;
+	void			replay(const decoded&);
+
+// Memory access through the bus
+protected:
+
+	Byte			load(Word addr)
+					{ return static_cast<Bus *>(this)->bus_read(addr); }
+	void			store(Word addr, Byte val)
+					{ static_cast<Bus *>(this)->bus_write(addr, val); }
+	Word			load_word(Word);
+	void			store_word(Word, Word);
+	Byte			*span(Word addr, Word len, int write)
+					{ return static_cast<Bus *>(this)->bus_span(addr, len, write); }
+
 private:
 
+	const opcode		*lastop;	// Last dispatched table entry
+	const Byte		*ireplay;	// Bytes of instruction in replay
+	Byte			ibytes[decoded::max_len]; // Bytes fetched so far
+	int			ilen;		// Number of bytes fetched so far
+
+	static bool		optables_ready;
+	static bool		init_optables(void);
+	static Byte		stack_cycles(Byte);
+
+	void			dispatch(const opcode&);
+	void			prefix10(), prefix11();
+	void			illegal();
+
 	Word&			refreg(Byte);
 	Byte&			byterefreg(int);
 	Word&			wordrefreg(int);
@@ -84,6 +306,8 @@ private:
 	Word			do_effective_address(Byte);
 	void			do_predecrement(Byte);
 	void			do_postincrement(Byte);
+	static bool		is_wmode(Byte post)
+					{ return (post & 0x9f) == 0x8f || (post & 0x9f) == 0x90; }
 
 	void			abx();
 	void			adca(), adcb();
@@ -145,8 +369,37 @@ private:
 	void			tfr();
 	void			tsta(), tstb(), tst();
 
+	// HD6309
+	void			add_r(), adc_r(), sub_r(), sbc_r();
+	void			and_r(), or_r(), eor_r(), cmp_r();
+	void			adcd(), adde(), addf(), addw();
+	void			aim(), oim(), eim(), tim();
+	void			andd(), bitd(), eord(), ord();
+	void			band(), biand(), bor(), bior(), beor(), bieor();
+	void			ldbt(), stbt();
+	void			bitmd(), ldmd();
+	void			clrd(), clre(), clrf(), clrw();
+	void			cmpe(), cmpf(), cmpw();
+	void			comd(), come(), comf(), comw();
+	void			decd(), dece(), decf(), decw();
+	void			divd(), divq(), muld();
+	void			incd(), ince(), incf(), incw();
+	void			lde(), ldf(), ldw(), ldq();
+	void			lsld(), lsrd(), lsrw();
+	void			asrd(), negd();
+	void			rold(), rolw(), rord(), rorw();
+	void			pshsw(), pshuw(), pulsw(), puluw();
+	void			sbcd(), sube(), subf(), subw();
+	void			sexw();
+	void			ste(), stf(), stw(), stq();
+	void			tfm();
+	void			tstd(), tste(), tstf(), tstw();
+
 	void			do_br(int);
 	void			do_lbr(int);
+	void			do_trap(Byte);
+	void			do_psh_entire(void);
+	void			do_pul_entire(void);
 
 	void			do_nmi(void);
 	void			do_firq(void);
@@ -181,16 +434,121 @@ private:
 	void			help_sub(Word&);
 	void			help_tst(Byte);
 
+	void			help_adc(Word&);
+	void			help_add(Word&);
+	void			help_and(Word&);
+	void			help_asr(Word&);
+	void			help_bit(Word);
+	void			help_bitop(int);
+	void			help_clr(Word&);
+	void			help_com(Word&);
+	void			help_dec(Word&);
+	void			help_eor(Word&);
+	void			help_imm(int);
+	void			help_inc(Word&);
+	void			help_lsl(Word&);
+	void			help_lsr(Word&);
+	void			help_neg(Word&);
+	void			help_or(Word&);
+	void			help_regop(int);
+	void			help_rol(Word&);
+	void			help_ror(Word&);
+	void			help_sbc(Word&);
+	void			help_tst(Word);
+	Byte			help_narrow(int, int);
+	Word			help_widen(int);
+
 protected:
+	virtual Word		read_word(Word) final;
+	virtual void		write_word(Word, Word) final;
+	virtual Byte		fetch(void) final;
+	virtual Word		fetch_word(void) final;
 	virtual void		execute(void);
 
 public:
-				mc6809();		// public constructor
-	virtual			~mc6809();		// public destructor
+				mc6809_core();		// public constructor
+	virtual			~mc6809_core();		// public destructor
 
 	virtual void		reset(void);		// CPU reset
 	virtual void		status(void);
 
 };
 
+// Interrupt lines the CPU responds to with the current masks
+template <class Bus>
+inline Byte mc6809_core<Bus>::active_lines(void) const
+{
+	Byte	active = lines & line_nmi;
+
+	if (!cc.bit.f) active |= lines & line_firq;
+	if (!cc.bit.i) active |= lines & line_irq;
+
+	return active;
+}
+
+// Called before each instruction, returns true if no
+// instruction should be executed
+template <class Bus>
+inline int mc6809_core<Bus>::poll_interrupts(void)
+{
+	return (lines | waiting) ? do_interrupt() : 0;
+}
+
+// Any line, masked or not, ends SYNC
+template <class Bus>
+inline int mc6809_core<Bus>::idle(void) const
+{
+	return waiting && !(waiting == wait_sync ? lines : active_lines());
+}
+
+// Record the flags of an operation for later evaluation
+template <class Bus>
+inline void mc6809_core<Bus>::defer_cc(int op, Word x, Word m, DWord res)
+{
+	// Flags of the pending operation that this one leaves
+	// alone have to be worked out before they are lost
+	if (ccmask[ccop] & ~ccmask[op]) {
+		sync_cc();
+	}
+
+	ccop = op;
+	ccx = x;
+	ccm = m;
+	ccres = res;
+
+	if (!lazycc) {
+		sync_cc();
+	}
+}
+
+// Bring the condition code register up to date
+template <class Bus>
+inline void mc6809_core<Bus>::sync_cc(void)
+{
+	if (ccop != cc_none) {
+		cc.all = eval_cc();
+		ccop = cc_none;
+	}
+}
+
+//
+//	MC6809 on the virtual USim memory bus
+//
+
+class mc6809 : public mc6809_core<mc6809> {
+
+	friend class mc6809_core<mc6809>;
+
+protected:
+
+	Byte			bus_read(Word addr) { return read(addr); }
+	void			bus_write(Word addr, Byte val) { write(addr, val); }
+	Byte			*bus_span(Word, Word, int) { return 0; }
+
+public:
+				mc6809();		// public constructor
+	virtual			~mc6809();		// public destructor
+
+};
+
 #endif // __mc6809_h__
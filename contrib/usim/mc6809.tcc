@@ -0,0 +1,780 @@
+//
+//	mc6809.tcc
+//
+//	Member templates of mc6809_core, included by each translation
+//	unit that instantiates the core for a bus
+//
+//	(C) R.P.Bellis
+//
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "machdep.h"
+#include "usim.h"
+#include "mc6809.h"
+
+template <class Bus>
+mc6809_core<Bus>::mc6809_core() : a(acc.byte.a), b(acc.byte.b), d(acc.d),
+	e(accw.byte.e), f(accw.byte.f), w(accw.w)
+{
+	is6309 = 0;
+	md = 0;
+	zero = 0;
+	v = 0;
+	w = 0;
+	ea = 0;
+	lastop = 0;
+	ireplay = 0;
+	ilen = 0;
+	lazycc = 0;
+	ccop = cc_none;
+	cycles = 0;
+	lines = 0;
+	waiting = wait_none;
+	nmiarmed = 0;
+	memory = new Byte[0x10000L];
+
+	// The bus is not constructed yet, so the reset vector
+	// is fetched by the derived class calling reset()
+	pc = 0;
+	dp = 0x00;
+	cc.all = 0x50;
+}
+
+template <class Bus>
+mc6809_core<Bus>::~mc6809_core()
+{
+	delete[] memory;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::reset(void)
+{
+	pc = load_word(0xfffe);
+	dp = 0x00;		/* Direct page register = 0x00 */
+	md = 0x00;		/* Emulation mode */
+	ccop = cc_none;		/* Drop pending flags */
+	cc.all = 0x00;		/* Clear all flags */
+	cc.bit.i = 1;		/* IRQ disabled */
+	cc.bit.f = 1;		/* FIRQ disabled */
+	lines &= ~line_nmi;	/* Forget a latched NMI */
+	waiting = wait_none;
+	nmiarmed = 0;		/* NMI disabled until S is loaded */
+}
+
+template <class Bus>
+void mc6809_core<Bus>::status(void)
+{
+}
+
+template <class Bus>
+void mc6809_core<Bus>::execute(void)
+{
+	if (poll_interrupts()) {
+		return;
+	}
+
+	ilen = 0;
+	ir = fetch();
+	dispatch(optable0[is6309][ir]);
+}
+
+template <class Bus>
+inline void mc6809_core<Bus>::dispatch(const opcode& op)
+{
+	lastop = &op;
+	mode = op.mode;
+	cycles += op.cycles;
+	(this->*op.fn)();
+}
+
+template <class Bus>
+void mc6809_core<Bus>::prefix10(void)
+{
+	Byte		post = fetch();
+	ir = 0x1000 | post;
+	dispatch(optable10[is6309][post]);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::prefix11(void)
+{
+	Byte		post = fetch();
+	ir = 0x1100 | post;
+	dispatch(optable11[is6309][post]);
+}
+
+//----------------------------------------------------------------------------
+// Interrupts
+//
+// IRQ and FIRQ are level sensitive and are set and cleared by the
+// devices, NMI is edge triggered and stays latched until taken.
+//----------------------------------------------------------------------------
+template <class Bus>
+void mc6809_core<Bus>::nmi(void)
+{
+	if (nmiarmed) {
+		lines |= line_nmi;
+	}
+}
+
+template <class Bus>
+void mc6809_core<Bus>::firq(int state)
+{
+	if (state) {
+		lines |= line_firq;
+	} else {
+		lines &= ~line_firq;
+	}
+}
+
+template <class Bus>
+void mc6809_core<Bus>::irq(int state)
+{
+	if (state) {
+		lines |= line_irq;
+	} else {
+		lines &= ~line_irq;
+	}
+}
+
+template <class Bus>
+int mc6809_core<Bus>::do_interrupt(void)
+{
+	Byte	active = active_lines();
+
+	if (!active) {
+		// A masked interrupt ends SYNC without being taken
+		if (waiting == wait_sync && lines) {
+			waiting = wait_none;
+		}
+		return waiting != wait_none;
+	}
+
+	if (active & line_nmi) {
+		lines &= ~line_nmi;
+		do_nmi();
+	} else if (active & line_firq) {
+		do_firq();
+	} else {
+		do_irq();
+	}
+	waiting = wait_none;
+
+	return 1;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::hd6309(int state)
+{
+	is6309 = state ? 1 : 0;
+}
+
+// Pending flags are evaluated, so a saved state does not
+// depend on lazy or eager flag mode
+template <class Bus>
+void mc6809_core<Bus>::get_state(state& st) const
+{
+	st.cycles = cycles;
+	st.pc = pc;
+	st.u = u;
+	st.s = s;
+	st.x = x;
+	st.y = y;
+	st.d = d;
+	st.w = w;
+	st.v = v;
+	st.dp = dp;
+	st.cc = get_cc();
+	st.md = md;
+	st.lines = lines;
+	st.waiting = waiting;
+	st.nmiarmed = nmiarmed ? 1 : 0;
+	st.is6309 = is6309;
+	st.pad = 0;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::set_state(const state& st)
+{
+	cycles = st.cycles;
+	pc = st.pc;
+	u = st.u;
+	s = st.s;
+	x = st.x;
+	y = st.y;
+	d = st.d;
+	w = st.w;
+	v = st.v;
+	dp = st.dp;
+	ccop = cc_none;
+	cc.all = st.cc;
+	md = st.md;
+	lines = st.lines;
+	waiting = st.waiting;
+	nmiarmed = st.nmiarmed;
+	is6309 = st.is6309 ? 1 : 0;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::illegal(void)
+{
+	// TODO: make run-time selectable
+	invalid("instruction");
+}
+
+//----------------------------------------------------------------------------
+// Lazy condition codes
+//
+// Instructions that set flags from a result only record the kind of
+// operation, its operands and its result. The flags are worked out
+// when something reads the condition code register. In eager mode
+// they are worked out straight away.
+//----------------------------------------------------------------------------
+template <class Bus>
+const Byte	mc6809_core<Bus>::ccmask[] = {
+	0x00,			// cc_none
+	0x2f,			// cc_add8
+	0x0f,			// cc_sub8
+	0x0f,			// cc_add16
+	0x0f,			// cc_sub16
+	0x0e,			// cc_ld8
+	0x0e,			// cc_ld16
+	0x0e,			// cc_inc8
+	0x0e			// cc_dec8
+};
+
+template <class Bus>
+void mc6809_core<Bus>::lazy_flags(int state)
+{
+	sync_cc();
+	lazycc = state;
+}
+
+template <class Bus>
+Byte mc6809_core<Bus>::get_cc(void) const
+{
+	return eval_cc();
+}
+
+template <class Bus>
+Byte mc6809_core<Bus>::eval_cc(void) const
+{
+	decltype(cc)	t = cc;
+
+	switch (ccop) {
+		case cc_add8:
+			t.bit.h = btst((Byte)(ccx ^ ccm ^ ccres), 4);
+			t.bit.c = btst((Word)ccres, 8);
+			t.bit.v = btst((Byte)(ccx ^ ccm ^ ccres), 7) ^ t.bit.c;
+			t.bit.n = btst((Byte)ccres, 7);
+			t.bit.z = !(Byte)ccres;
+			break;
+		case cc_sub8:
+			t.bit.v = btst((Byte)(ccx ^ ccm ^ ccres ^ ((Word)ccres >> 1)), 7);
+			t.bit.c = btst((Word)ccres, 8);
+			t.bit.n = btst((Byte)ccres, 7);
+			t.bit.z = !(Byte)ccres;
+			break;
+		case cc_add16:
+			t.bit.c = btst(ccres, 16);
+			t.bit.v = btst((Word)(ccx ^ ccm ^ ccres), 15) ^ t.bit.c;
+			t.bit.n = btst((Word)ccres, 15);
+			t.bit.z = !(Word)ccres;
+			break;
+		case cc_sub16:
+			t.bit.v = btst((DWord)(ccx ^ ccm ^ ccres ^ (ccres >> 1)), 15);
+			t.bit.c = btst(ccres, 16);
+			t.bit.n = btst(ccres, 15);
+			t.bit.z = !(Word)ccres;
+			break;
+		case cc_ld8:
+			t.bit.n = btst((Byte)ccres, 7);
+			t.bit.v = 0;
+			t.bit.z = !(Byte)ccres;
+			break;
+		case cc_ld16:
+			t.bit.n = btst((Word)ccres, 15);
+			t.bit.v = 0;
+			t.bit.z = !(Word)ccres;
+			break;
+		case cc_inc8:
+			t.bit.v = ((Byte)ccres == 0x80);
+			t.bit.n = btst((Byte)ccres, 7);
+			t.bit.z = !(Byte)ccres;
+			break;
+		case cc_dec8:
+			t.bit.v = ((Byte)ccres == 0x7f);
+			t.bit.n = btst((Byte)ccres, 7);
+			t.bit.z = !(Byte)ccres;
+			break;
+	}
+
+	return t.all;
+}
+
+//----------------------------------------------------------------------------
+// Instruction stream access, capture and replay
+//----------------------------------------------------------------------------
+template <class Bus>
+Byte mc6809_core<Bus>::fetch(void)
+{
+	Byte		val;
+
+	if (ireplay) {
+		val = *ireplay++;
+	} else {
+		val = load(pc);
+		if (ilen < decoded::max_len) {
+			ibytes[ilen] = val;
+		}
+		ilen++;
+	}
+	pc += 1;
+
+	return val;
+}
+
+template <class Bus>
+Word mc6809_core<Bus>::fetch_word(void)
+{
+	Word		val;
+
+	val = fetch();
+	val <<= 8;
+	val |= fetch();
+
+	return val;
+}
+
+template <class Bus>
+Word mc6809_core<Bus>::load_word(Word addr)
+{
+	Word		val;
+
+	val = load(addr++);
+	val <<= 8;
+	val |= load(addr);
+
+	return val;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::store_word(Word addr, Word val)
+{
+	store(addr++, (Byte)(val >> 8));
+	store(addr, (Byte)val);
+}
+
+template <class Bus>
+Word mc6809_core<Bus>::read_word(Word addr)
+{
+	return load_word(addr);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::write_word(Word addr, Word val)
+{
+	store_word(addr, val);
+}
+
+// Record the instruction that was just executed by execute()
+// so that it can later be run again without fetching or decoding
+template <class Bus>
+bool mc6809_core<Bus>::capture(decoded& insn) const
+{
+	if (lastop == 0 || ilen > decoded::max_len) {
+		return false;
+	}
+
+	insn.op = lastop;
+	insn.ir = ir;
+	insn.len = ilen;
+	memcpy(insn.bytes, ibytes, ilen);
+
+	return true;
+}
+
+// Execute a captured instruction; pc must point at its first byte
+template <class Bus>
+void mc6809_core<Bus>::replay(const decoded& insn)
+{
+	const opcode	*op = static_cast<const opcode *>(insn.op);
+	int		oplen = (insn.ir > 0xff) ? 2 : 1;
+
+	ir = insn.ir;
+	pc += oplen;
+	mode = op->mode;
+	cycles += op->cycles;
+	lastop = 0;
+
+	ireplay = insn.bytes + oplen;
+	(this->*op->fn)();
+	ireplay = 0;
+}
+
+//----------------------------------------------------------------------------
+// Opcode dispatch tables, filled from the metadata in mc6809op.h
+//----------------------------------------------------------------------------
+template <class Bus>
+typename mc6809_core<Bus>::opcode	mc6809_core<Bus>::optable0[2][256];
+template <class Bus>
+typename mc6809_core<Bus>::opcode	mc6809_core<Bus>::optable10[2][256];
+template <class Bus>
+typename mc6809_core<Bus>::opcode	mc6809_core<Bus>::optable11[2][256];
+
+template <class Bus>
+bool		mc6809_core<Bus>::optables_ready = mc6809_core<Bus>::init_optables();
+
+//----------------------------------------------------------------------------
+// Cycle counts
+//
+// The base counts are in mc6809op.h, the extras of indexed modes and
+// PSH/PUL are added here.
+//----------------------------------------------------------------------------
+
+// Indexed mode extras by postbyte bits 0-4, indirect forms included.
+// The HD6309 ,W modes (postbyte bits 0-4 of 0x0f and 0x10) are
+// counted by do_effective_address().
+template <class Bus>
+const Byte	mc6809_core<Bus>::idxcycles[32] = {
+//	 0  1  2  3  4  5  6  7  8  9  a  b  c  d  e  f
+	 2, 3, 2, 3, 0, 1, 1, 1, 1, 4, 1, 4, 1, 5, 1, 0,	// direct
+	 0, 6, 0, 6, 3, 4, 4, 4, 4, 7, 4, 7, 4, 8, 4, 5	// indirect
+};
+
+// Extra cycles for the bytes moved by PSH/PUL
+template <class Bus>
+Byte mc6809_core<Bus>::stack_cycles(Byte w)
+{
+	Byte		n = 0;
+
+	for (int i = 0; i < 8; i++) {
+		if (btst(w, i)) {
+			n += (i < 4) ? 1 : 2;
+		}
+	}
+
+	return n;
+}
+
+template <class Bus>
+bool mc6809_core<Bus>::init_optables(void)
+{
+	// Handlers by mnemonic
+	static const handler	handlers[] = {
+#define X(fn, name)	&mc6809_core::fn,
+		MC6809_MNEMONICS(X)
+#undef X
+	};
+
+	for (int c = 0; c < 2; c++) {
+		for (int i = 0; i < 256; i++) {
+			opcode		*op[3] = {
+				&optable0[c][i], &optable10[c][i], &optable11[c][i]
+			};
+
+			for (int p = 0; p < 3; p++) {
+				const mc6809_opinfo&	info = mc6809_optable_data.op[c][p][i];
+
+				op[p]->fn = handlers[info.mnemonic];
+				op[p]->mode = (addrmode)info.mode;
+				op[p]->cycles = info.cycles;
+			}
+		}
+	}
+
+	return true;
+}
+
+template <class Bus>
+Word& mc6809_core<Bus>::refreg(Byte post)
+{
+	post &= 0x60;
+	post >>= 5;
+
+	if (post == 0) {
+		return x;
+	} else if (post == 1) {
+		return y;
+	} else if (post == 2) {
+		return u;
+	} else {
+		return s;
+	}
+}
+
+template <class Bus>
+Byte& mc6809_core<Bus>::byterefreg(int r)
+{
+	if (r == 0x08) {
+		return a;
+	} else if (r == 0x09) {
+		return b;
+	} else if (r == 0x0a) {
+		return cc.all;
+	} else if (r == 0x0b) {
+		return dp;
+	} else if (r == 0x0e) {
+		return e;
+	} else if (r == 0x0f) {
+		return f;
+	} else {
+		// 0x0c and 0x0d are the HD6309 zero register
+		return zero;
+	}
+}
+
+template <class Bus>
+Word& mc6809_core<Bus>::wordrefreg(int r)
+{
+	if (r == 0x00) {
+		return d;
+	} else if (r == 0x01) {
+		return x;
+	} else if (r == 0x02) {
+		return y;
+	} else if (r == 0x03) {
+		return u;
+	} else if (r == 0x04) {
+		return s;
+	} else if (r == 0x06) {
+		return w;
+	} else if (r == 0x07) {
+		return v;
+	} else {
+		return pc;
+	}
+}
+
+template <class Bus>
+Byte mc6809_core<Bus>::fetch_operand(void)
+{
+	Byte		ret = 0;
+	Word		addr;
+
+	if (mode == immediate) {
+		ret = fetch();
+	} else if (mode == relative) {
+		ret = fetch();
+	} else if (mode == extended) {
+		addr = fetch_word();
+		ea = addr;
+		ret = load(addr);
+	} else if (mode == direct) {
+		addr = ((Word)dp << 8) | fetch();
+		ea = addr;
+		ret = load(addr);
+	} else if (mode == indexed) {
+		Byte		post = fetch();
+		do_predecrement(post);
+		addr = do_effective_address(post);
+		ea = addr;
+		ret = load(addr);
+		do_postincrement(post);
+	} else {
+		invalid("addressing mode");
+	}
+
+	return ret;
+}
+
+template <class Bus>
+Word mc6809_core<Bus>::fetch_word_operand(void)
+{
+	Word		addr, ret = 0;
+
+	if (mode == immediate) {
+		ret = fetch_word();
+	} else if (mode == relative) {
+		ret = fetch_word();
+	} else if (mode == extended) {
+		addr = fetch_word();
+		ea = addr;
+		ret = load_word(addr);
+	} else if (mode == direct) {
+		addr = (Word)dp << 8 | fetch();
+		ea = addr;
+		ret = load_word(addr);
+	} else if (mode == indexed) {
+		Byte	post = fetch();
+		do_predecrement(post);
+		addr = do_effective_address(post);
+		do_postincrement(post);
+		ea = addr;
+		ret = load_word(addr);
+	} else {
+		invalid("addressing mode");
+	}
+
+	return ret;
+}
+
+template <class Bus>
+Word mc6809_core<Bus>::fetch_effective_address(void)
+{
+	Word		addr = 0;
+
+	if (mode == extended) {
+		addr = fetch_word();
+	} else if (mode == direct) {
+		addr = (Word)dp << 8 | fetch();
+	} else if (mode == indexed) {
+		Byte		post = fetch();
+		do_predecrement(post);
+		addr = do_effective_address(post);
+		do_postincrement(post);
+	} else {
+		invalid("addressing mode");
+	}
+	ea = addr;
+
+	return addr;
+}
+
+template <class Bus>
+Word mc6809_core<Bus>::do_effective_address(Byte post)
+{
+	Word		addr = 0;
+
+	if ((post & 0x80) == 0x00) {
+		addr = refreg(post) + extend5(post & 0x1f);
+		cycles += 1;
+	} else if (is6309 && is_wmode(post)) {
+		// HD6309 ,W n16,W ,W++ ,--W and their indirect forms
+		switch (post & 0x60) {
+			case 0x00:
+				addr = w;
+				break;
+			case 0x20:
+				addr = w + fetch_word();
+				cycles += 2;
+				break;
+			default:
+				addr = w;
+				cycles += 1;
+				break;
+		}
+		if (post & 0x10) {
+			addr = load_word(addr);
+			cycles += 3;
+		}
+	} else {
+		cycles += idxcycles[post & 0x1f];
+		switch (post & 0x1f) {
+			case 0x00: case 0x02:
+				addr = refreg(post);
+				break;
+			case 0x01: case 0x03: case 0x11: case 0x13:
+				addr = refreg(post);
+				break;
+			case 0x04: case 0x14:
+				addr = refreg(post);
+				break;
+			case 0x05: case 0x15:
+				addr = extend8(b) + refreg(post);
+				break;
+			case 0x06: case 0x16:
+				addr = extend8(a) + refreg(post);
+				break;
+			case 0x07: case 0x17:
+				if (!is6309) {
+					invalid("indexed mode");
+					break;
+				}
+				addr = extend8(e) + refreg(post);
+				break;
+			case 0x0a: case 0x1a:
+				if (!is6309) {
+					invalid("indexed mode");
+					break;
+				}
+				addr = extend8(f) + refreg(post);
+				break;
+			case 0x0e: case 0x1e:
+				if (!is6309) {
+					invalid("indexed mode");
+					break;
+				}
+				addr = w + refreg(post);
+				break;
+			case 0x08: case 0x18:
+				addr = refreg(post) + extend8(fetch());
+				break;
+			case 0x09: case 0x19:
+				addr = refreg(post) + fetch_word();
+				break;
+			case 0x0b: case 0x1b:
+				addr = d + refreg(post);
+				break;
+			case 0x0c: case 0x1c:
+				addr = extend8(fetch()); // NB: fetch first
+				addr += pc;
+				break;
+			case 0x0d: case 0x1d:
+				addr = fetch_word();	 // NB: fetch first
+				addr += pc;
+				break;
+			case 0x1f:
+				addr = fetch_word();
+				break;
+			default:
+				invalid("indirect addressing postbyte");
+				break;
+		}
+
+		/* Do extra indirection */
+		if (post & 0x10) {
+			addr = load_word(addr);
+		}
+	}
+
+	return addr;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::do_postincrement(Byte post)
+{
+	if (is6309 && is_wmode(post)) {
+		if ((post & 0x60) == 0x40) {
+			w += 2;
+		}
+		return;
+	}
+
+	switch (post & 0x9f) {
+		case 0x80:
+			refreg(post) += 1;
+			break;
+		case 0x90:
+			invalid("postincrement");
+			break;
+		case 0x81: case 0x91:
+			refreg(post) += 2;
+			break;
+	}
+}
+
+template <class Bus>
+void mc6809_core<Bus>::do_predecrement(Byte post)
+{
+	if (is6309 && is_wmode(post)) {
+		if ((post & 0x60) == 0x60) {
+			w -= 2;
+		}
+		return;
+	}
+
+	switch (post & 0x9f) {
+		case 0x82:
+			refreg(post) -= 1;
+			break;
+		case 0x92:
+			invalid("predecrement");
+			break;
+		case 0x83: case 0x93:
+			refreg(post) -= 2;
+			break;
+	}
+}
@@ -130,7 +130,7 @@ void mc6809_X::status(void)
 	text( 6, 5, hexstr(y));
 	text(15, 4, hexstr(a));
 	text(15, 5, hexstr(b));
-	text(15, 2, binstr(cc.all));
+	text(15, 2, binstr(get_cc()));
 
 	Word		stk = ((s >> 3) << 3) - 16;
 	Word		stk_tmp = stk;
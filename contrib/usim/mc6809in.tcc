@@ -0,0 +1,2364 @@
+//
+//	mc6809in.tcc
+//
+//	(C) R.P.Bellis
+//
+//	Updated from BDA and Soren Roug 12/2003 primarily
+//	with fixes for SBC / CMP / NEG instructions with
+//	incorrect carry flag settings
+//
+
+#include <stdio.h>
+#include <string.h>
+#include "usim.h"
+#include "mc6809.h"
+
+template <class Bus>
+void mc6809_core<Bus>::abx(void)
+{
+	x += b;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_adc(Byte& x)
+{
+	Byte	m = fetch_operand();
+	sync_cc();
+	Word	t = x + m + cc.bit.c;
+
+	defer_cc(cc_add8, x, m, t);
+	x = t & 0xff;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::adca(void)
+{
+	help_adc(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::adcb(void)
+{
+	help_adc(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_add(Byte& x)
+{
+	Byte	m = fetch_operand();
+	Word	t = x + m;
+
+	defer_cc(cc_add8, x, m, t);
+	x = t & 0xff;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::adda(void)
+{
+	help_add(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::addb(void)
+{
+	help_add(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::addd(void)
+{
+	Word	m = fetch_word_operand();
+	DWord	t = (DWord)d + m;
+
+	defer_cc(cc_add16, d, m, t);
+	d = (Word)(t & 0xffff);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_and(Byte& x)
+{
+	x = x & fetch_operand();
+	defer_cc(cc_ld8, 0, 0, x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::anda(void)
+{
+	help_and(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::andb(void)
+{
+	help_and(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::andcc(void)
+{
+	sync_cc();
+	cc.all &= fetch();
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_asr(Byte& x)
+{
+	sync_cc();
+	cc.bit.c = btst(x, 0);
+	x >>= 1;	/* Shift word right */
+	if ((cc.bit.n = btst(x, 6)) != 0) {
+		bset(x, 7);
+	}
+	cc.bit.z = !x;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::asra(void)
+{
+	help_asr(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::asrb(void)
+{
+	help_asr(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::asr(void)
+{
+	Word	addr = fetch_effective_address();
+	Byte	m = load(addr);
+
+	help_asr(m);
+	store(addr, m);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bcc(void)
+{
+	sync_cc();
+	do_br(!cc.bit.c);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lbcc(void)
+{
+	sync_cc();
+	do_lbr(!cc.bit.c);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bcs(void)
+{
+	sync_cc();
+	do_br(cc.bit.c);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lbcs(void)
+{
+	sync_cc();
+	do_lbr(cc.bit.c);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::beq(void)
+{
+	sync_cc();
+	do_br(cc.bit.z);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lbeq(void)
+{
+	sync_cc();
+	do_lbr(cc.bit.z);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bge(void)
+{
+	sync_cc();
+	do_br(!(cc.bit.n ^ cc.bit.v));
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lbge(void)
+{
+	sync_cc();
+	do_lbr(!(cc.bit.n ^ cc.bit.v));
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bgt(void)
+{
+	sync_cc();
+	do_br(!(cc.bit.z | (cc.bit.n ^ cc.bit.v)));
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lbgt(void)
+{
+	sync_cc();
+	do_lbr(!(cc.bit.z | (cc.bit.n ^ cc.bit.v)));
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bhi(void)
+{
+	sync_cc();
+	do_br(!(cc.bit.c | cc.bit.z));
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lbhi(void)
+{
+	sync_cc();
+	do_lbr(!(cc.bit.c | cc.bit.z));
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bita(void)
+{
+	help_bit(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bitb(void)
+{
+	help_bit(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_bit(Byte x)
+{
+	Byte t = x & fetch_operand();
+	defer_cc(cc_ld8, 0, 0, t);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::ble(void)
+{
+	sync_cc();
+	do_br(cc.bit.z | (cc.bit.n ^ cc.bit.v));
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lble(void)
+{
+	sync_cc();
+	do_lbr(cc.bit.z | (cc.bit.n ^ cc.bit.v));
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bls(void)
+{
+	sync_cc();
+	do_br(cc.bit.c | cc.bit.z);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lbls(void)
+{
+	sync_cc();
+	do_lbr(cc.bit.c | cc.bit.z);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::blt(void)
+{
+	sync_cc();
+	do_br(cc.bit.n ^ cc.bit.v);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lblt(void)
+{
+	sync_cc();
+	do_lbr(cc.bit.n ^ cc.bit.v);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bmi(void)
+{
+	sync_cc();
+	do_br(cc.bit.n);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lbmi(void)
+{
+	sync_cc();
+	do_lbr(cc.bit.n);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bne(void)
+{
+	sync_cc();
+	do_br(!cc.bit.z);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lbne(void)
+{
+	sync_cc();
+	do_lbr(!cc.bit.z);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bpl(void)
+{
+	sync_cc();
+	do_br(!cc.bit.n);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lbpl(void)
+{
+	sync_cc();
+	do_lbr(!cc.bit.n);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bra(void)
+{
+	do_br(1);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lbra(void)
+{
+	Word offset = fetch_word_operand();
+	pc += offset;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::brn(void)
+{
+	do_br(0);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lbrn(void)
+{
+	do_lbr(0);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bsr(void)
+{
+	Byte	x = fetch();
+	store(--s, (Byte)pc);
+	store(--s, (Byte)(pc >> 8));
+	pc += extend8(x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lbsr(void)
+{
+	Word	x = fetch_word();
+	store(--s, (Byte)pc);
+	store(--s, (Byte)(pc >> 8));
+	pc += x;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bvc(void)
+{
+	sync_cc();
+	do_br(!cc.bit.v);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lbvc(void)
+{
+	sync_cc();
+	do_lbr(!cc.bit.v);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bvs(void)
+{
+	sync_cc();
+	do_br(cc.bit.v);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lbvs(void)
+{
+	sync_cc();
+	do_lbr(cc.bit.v);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::clra(void)
+{
+	help_clr(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::clrb(void)
+{
+	help_clr(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::clr(void)
+{
+	Word	addr = fetch_effective_address();
+	Byte	m = load(addr);
+	help_clr(m);
+	store(addr, m);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_clr(Byte& x)
+{
+	sync_cc();
+	cc.all &= 0xf0;
+	cc.all |= 0x04;
+	x = 0;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::cmpa(void)
+{
+	help_cmp(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::cmpb(void)
+{
+	help_cmp(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_cmp(Byte x)
+{
+	Byte	m = fetch_operand();
+	int	t = x - m;
+
+	defer_cc(cc_sub8, x, m, t);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::cmpd(void)
+{
+	help_cmp(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::cmpx(void)
+{
+	help_cmp(x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::cmpy(void)
+{
+	help_cmp(y);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::cmpu(void)
+{
+	help_cmp(u);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::cmps(void)
+{
+	help_cmp(s);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_cmp(Word x)
+{
+	Word	m = fetch_word_operand();
+	long	t = x - m;
+
+	defer_cc(cc_sub16, x, m, t);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::coma(void)
+{
+	help_com(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::comb(void)
+{
+	help_com(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::com(void)
+{
+	Word	addr = fetch_effective_address();
+	Byte	m = load(addr);
+	help_com(m);
+	store(addr, m);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_com(Byte& x)
+{
+	sync_cc();
+	x = ~x;
+	cc.bit.c = 1;
+	cc.bit.v = 0;
+	cc.bit.n = btst(x, 7);
+	cc.bit.z = !x;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::cwai(void)
+{
+	Byte	m = fetch();
+
+	sync_cc();
+	cc.all &= m;
+	do_psh_entire();
+	waiting = wait_cwai;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::daa(void)
+{
+	Byte	c = 0;
+	Byte	lsn = (a & 0x0f);
+	Byte	msn = (a & 0xf0) >> 4;
+
+	sync_cc();
+	if (cc.bit.h || (lsn > 9)) {
+		c |= 0x06;
+	}
+
+	if (cc.bit.c ||
+	    (msn > 9) ||
+	    ((msn > 8) && (lsn > 9))) {
+		c |= 0x60;
+	}
+
+	{
+		Word	t = (Word)a + c;
+		cc.bit.c = btst(t, 8);
+		a = (Byte)t;
+	}
+
+	cc.bit.n = btst(a, 7);
+	cc.bit.z = !a;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::deca(void)
+{
+	help_dec(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::decb(void)
+{
+	help_dec(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::dec(void)
+{
+	Word	addr = fetch_effective_address();
+	Byte	m = load(addr);
+	help_dec(m);
+	store(addr, m);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_dec(Byte& x)
+{
+	x = x - 1;
+	defer_cc(cc_dec8, 0, 0, x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::eora(void)
+{
+	help_eor(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::eorb(void)
+{
+	help_eor(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_eor(Byte& x)
+{
+	x = x ^ fetch_operand();
+	defer_cc(cc_ld8, 0, 0, x);
+}
+
+static void swap(Byte& r1, Byte &r2)
+{
+	Byte	t;
+	t = r1; r1 = r2; r2 = t;
+}
+
+static void swap(Word& r1, Word &r2)
+{
+	Word	t;
+	t = r1; r1 = r2; r2 = t;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::exg(void)
+{
+	int	r1, r2;
+	Byte	w = fetch();
+	sync_cc();
+	r1 = (w & 0xf0) >> 4;
+	r2 = (w & 0x0f) >> 0;
+	if (is6309) {
+		Word	t1 = (r2 < 8) ? help_widen(r1) : help_narrow(r1, r2);
+		Word	t2 = (r1 < 8) ? help_widen(r2) : help_narrow(r2, r1);
+		if (r1 < 8) wordrefreg(r1) = t2; else byterefreg(r1) = (Byte)t2;
+		if (r2 < 8) wordrefreg(r2) = t1; else byterefreg(r2) = (Byte)t1;
+		zero = 0;
+		return;
+	}
+	if (r1 <= 5) {
+		if (r2 > 5) {
+			invalid("exchange register");
+			return;
+		}
+		swap(wordrefreg(r2), wordrefreg(r1));
+	} else if (r1 >= 8 && r1 <= 11) {
+		if (r2 < 8 || r2 > 11) {
+			invalid("exchange register");
+			return;
+		}
+		swap(byterefreg(r2), byterefreg(r1));
+	} else  {
+		invalid("exchange register");
+		return;
+	}
+}
+
+template <class Bus>
+void mc6809_core<Bus>::inca(void)
+{
+	help_inc(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::incb(void)
+{
+	help_inc(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::inc(void)
+{
+	Word	addr = fetch_effective_address();
+	Byte	m = load(addr);
+	help_inc(m);
+	store(addr, m);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_inc(Byte& x)
+{
+	x = x + 1;
+	defer_cc(cc_inc8, 0, 0, x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::jmp(void)
+{
+	pc = fetch_effective_address();
+}
+
+template <class Bus>
+void mc6809_core<Bus>::jsr(void)
+{
+	Word	addr = fetch_effective_address();
+	store(--s, (pc >> 0) & 0xff);
+	store(--s, (pc >> 8) & 0xff);
+	pc = addr;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lda(void)
+{
+	help_ld(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::ldb(void)
+{
+	help_ld(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_ld(Byte& x)
+{
+	x = fetch_operand();
+	defer_cc(cc_ld8, 0, 0, x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::ldd(void)
+{
+	help_ld(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::ldx(void)
+{
+	help_ld(x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::ldy(void)
+{
+	help_ld(y);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lds(void)
+{
+	help_ld(s);
+	nmiarmed = 1;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::ldu(void)
+{
+	help_ld(u);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_ld(Word& x)
+{
+	x = fetch_word_operand();
+	defer_cc(cc_ld16, 0, 0, x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::leax(void)
+{
+	x = fetch_effective_address();
+	sync_cc();
+	cc.bit.z = !x;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::leay(void)
+{
+	y = fetch_effective_address();
+	sync_cc();
+	cc.bit.z = !y;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::leas(void)
+{
+	s = fetch_effective_address();
+}
+
+template <class Bus>
+void mc6809_core<Bus>::leau(void)
+{
+	u = fetch_effective_address();
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lsla(void)
+{
+	help_lsl(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lslb(void)
+{
+	help_lsl(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lsl(void)
+{
+	Word	addr = fetch_effective_address();
+	Byte	m = load(addr);
+	help_lsl(m);
+	store(addr, m);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_lsl(Byte& x)
+{
+	sync_cc();
+	cc.bit.c = btst(x, 7);
+	cc.bit.v = btst(x, 7) ^ btst(x, 6);
+	x <<= 1;
+	cc.bit.n = btst(x, 7);
+	cc.bit.z = !x;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lsra(void)
+{
+	help_lsr(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lsrb(void)
+{
+	help_lsr(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lsr(void)
+{
+	Word	addr = fetch_effective_address();
+	Byte	m = load(addr);
+	help_lsr(m);
+	store(addr, m);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_lsr(Byte& x)
+{
+	sync_cc();
+	cc.bit.c = btst(x, 0);
+	x >>= 1;	/* Shift word right */
+	cc.bit.n = 0;
+	cc.bit.z = !x;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::mul(void)
+{
+	d = a * b;
+	sync_cc();
+	cc.bit.c = btst(b, 7);
+	cc.bit.z = !d;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::nega(void)
+{
+	help_neg(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::negb(void)
+{
+	help_neg(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::neg(void)
+{
+	Word 	addr = fetch_effective_address();
+	Byte	m = load(addr);
+	help_neg(m);
+	store(addr, m);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_neg(Byte& x)
+{
+	int	t = 0 - x;
+
+	defer_cc(cc_sub8, 0, x, t);
+	x = t & 0xff;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::nop(void)
+{
+}
+
+template <class Bus>
+void mc6809_core<Bus>::ora(void)
+{
+	help_or(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::orb(void)
+{
+	help_or(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_or(Byte& x)
+{
+	x = x | fetch_operand();
+	defer_cc(cc_ld8, 0, 0, x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::orcc(void)
+{
+	sync_cc();
+	cc.all |= fetch_operand();
+}
+
+template <class Bus>
+void mc6809_core<Bus>::pshs(void)
+{
+	Byte	w = fetch();
+	cycles += stack_cycles(w);
+	help_psh(w, s, u);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::pshu(void)
+{
+	Byte	w = fetch();
+	cycles += stack_cycles(w);
+	help_psh(w, u, s);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_psh(Byte w, Word& s, Word& u)
+{
+	sync_cc();
+	if (btst(w, 7)) {
+		store(--s, (Byte)pc);
+		store(--s, (Byte)(pc >> 8));
+	}
+	if (btst(w, 6)) {
+		store(--s, (Byte)u);
+		store(--s, (Byte)(u >> 8));
+	}
+	if (btst(w, 5)) {
+		store(--s, (Byte)y);
+		store(--s, (Byte)(y >> 8));
+	}
+	if (btst(w, 4)) {
+		store(--s, (Byte)x);
+		store(--s, (Byte)(x >> 8));
+	}
+	if (btst(w, 3)) store(--s, (Byte)dp);
+	if (btst(w, 2)) store(--s, (Byte)b);
+	if (btst(w, 1)) store(--s, (Byte)a);
+	if (btst(w, 0)) store(--s, (Byte)cc.all);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::puls(void)
+{
+	Byte	w = fetch();
+	cycles += stack_cycles(w);
+	help_pul(w, s, u);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::pulu(void)
+{
+	Byte	w = fetch();
+	cycles += stack_cycles(w);
+	help_pul(w, u, s);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_pul(Byte w, Word& s, Word& u)
+{
+	sync_cc();
+	if (btst(w, 0)) cc.all = load(s++);
+	if (btst(w, 1)) a = load(s++);
+	if (btst(w, 2)) b = load(s++);
+	if (btst(w, 3)) dp = load(s++);
+	if (btst(w, 4)) {
+		x = load_word(s); s += 2;
+	}
+	if (btst(w, 5)) {
+		y = load_word(s); s += 2;
+	}
+	if (btst(w, 6)) {
+		u = load_word(s); s += 2;
+	}
+	if (btst(w, 7)) {
+		pc = load_word(s); s += 2;
+	}
+}
+
+template <class Bus>
+void mc6809_core<Bus>::rola(void)
+{
+	help_rol(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::rolb(void)
+{
+	help_rol(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::rol(void)
+{
+	Word	addr = fetch_effective_address();
+	Byte	m = load(addr);
+	help_rol(m);
+	store(addr, m);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_rol(Byte& x)
+{
+	sync_cc();
+	int	oc = cc.bit.c;
+	cc.bit.v = btst(x, 7) ^ btst(x, 6);
+	cc.bit.c = btst(x, 7);
+	x = x << 1;
+	if (oc) bset(x, 0);
+	cc.bit.n = btst(x, 7);
+	cc.bit.z = !x;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::rora(void)
+{
+	help_ror(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::rorb(void)
+{
+	help_ror(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::ror(void)
+{
+	Word	addr = fetch_effective_address();
+	Byte	m = load(addr);
+	help_ror(m);
+	store(addr, m);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_ror(Byte& x)
+{
+	sync_cc();
+	int	oc = cc.bit.c;
+	cc.bit.c = btst(x, 0);
+	x = x >> 1;
+	if (oc) bset(x, 7);
+	cc.bit.n = btst(x, 7);
+	cc.bit.z = !x;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::rti(void)
+{
+	help_pul(0x01, s, u);
+	if (cc.bit.e) {
+		do_pul_entire();
+		cycles += 9;
+	} else {
+		help_pul(0x80, s, u);
+	}
+}
+
+template <class Bus>
+void mc6809_core<Bus>::rts(void)
+{
+	pc = load_word(s);
+	s += 2;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::sbca(void)
+{
+	help_sbc(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::sbcb(void)
+{
+	help_sbc(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_sbc(Byte& x)
+{
+	Byte    m = fetch_operand();
+	sync_cc();
+	int t = x - m - cc.bit.c;
+
+	defer_cc(cc_sub8, x, m, t);
+	x = t & 0xff;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::sex(void)
+{
+	sync_cc();
+	cc.bit.n = btst(b, 7);
+	cc.bit.z = !b;
+	a = cc.bit.n ? 255 : 0;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::sta(void)
+{
+	help_st(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::stb(void)
+{
+	help_st(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_st(Byte x)
+{
+	Word	addr = fetch_effective_address();
+	store(addr, x);
+	defer_cc(cc_ld8, 0, 0, x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::std(void)
+{
+	help_st(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::stx(void)
+{
+	help_st(x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::sty(void)
+{
+	help_st(y);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::sts(void)
+{
+	help_st(s);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::stu(void)
+{
+	help_st(u);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_st(Word x)
+{
+	Word	addr = fetch_effective_address();
+	store_word(addr, x);
+	defer_cc(cc_ld16, 0, 0, x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::suba(void)
+{
+	help_sub(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::subb(void)
+{
+	help_sub(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_sub(Byte& x)
+{
+	Byte    m = fetch_operand();
+	int t = x - m;
+
+	defer_cc(cc_sub8, x, m, t);
+	x = t & 0xff;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_sub(Word& x)
+{
+	Word    m = fetch_word_operand();
+	long t = x - m;
+
+	defer_cc(cc_sub16, x, m, t);
+	x = t & 0xffff;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::subd(void)
+{
+	help_sub(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::swi(void)
+{
+	do_psh_entire();
+	cc.bit.f = cc.bit.i = 1;
+	pc = load_word(0xfffa);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::swi2(void)
+{
+	do_psh_entire();
+	pc = load_word(0xfff4);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::swi3(void)
+{
+	do_psh_entire();
+	pc = load_word(0xfff2);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::sync(void)
+{
+	waiting = wait_sync;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::tfr(void)
+{
+	int	r1, r2;
+	Byte	w = fetch();
+	sync_cc();
+	r1 = (w & 0xf0) >> 4;
+	r2 = (w & 0x0f) >> 0;
+	if (is6309) {
+		if (r2 < 8) {
+			wordrefreg(r2) = help_widen(r1);
+		} else {
+			byterefreg(r2) = help_narrow(r1, r2);
+		}
+		zero = 0;
+		return;
+	}
+	if (r1 <= 5) {
+		if (r2 > 5) {
+			invalid("transfer register");
+			return;
+		}
+		wordrefreg(r2) = wordrefreg(r1);
+	} else if (r1 >= 8 && r1 <= 11) {
+		if (r2 < 8 || r2 > 11) {
+			invalid("transfer register");
+			return;
+		}
+		byterefreg(r2) = byterefreg(r1);
+	} else  {
+		invalid("transfer register");
+		return;
+	}
+}
+
+template <class Bus>
+void mc6809_core<Bus>::tsta(void)
+{
+	help_tst(a);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::tstb(void)
+{
+	help_tst(b);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::tst(void)
+{
+	Word	addr = fetch_effective_address();
+	Byte	m = load(addr);
+	help_tst(m);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_tst(Byte x)
+{
+	defer_cc(cc_ld8, 0, 0, x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::do_br(int test)
+{
+	Word offset = extend8(fetch_operand());
+	if (test) pc += offset;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::do_lbr(int test)
+{
+	Word offset = fetch_word_operand();
+	if (test) {
+		pc += offset;
+		cycles += 1;
+	}
+}
+
+template <class Bus>
+void mc6809_core<Bus>::do_psh_entire(void)
+{
+	sync_cc();
+	cc.bit.e = 1;
+	help_psh(0xf8, s, u);
+	if (md & md_native) {
+		store(--s, f);
+		store(--s, e);
+		cycles += 2;
+	}
+	help_psh(0x07, s, u);
+}
+
+// Pull the rest of the entire state, CC has already been pulled
+template <class Bus>
+void mc6809_core<Bus>::do_pul_entire(void)
+{
+	help_pul(0x06, s, u);
+	if (md & md_native) {
+		e = load(s++);
+		f = load(s++);
+		cycles += 2;
+	}
+	help_pul(0xf8, s, u);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::do_trap(Byte reason)
+{
+	md |= reason;
+	do_psh_entire();
+	cc.bit.f = cc.bit.i = 1;
+	pc = load_word(0xfff0);
+}
+
+// CWAI has already stacked the entire state
+template <class Bus>
+void mc6809_core<Bus>::do_nmi(void)
+{
+	if (waiting != wait_cwai) {
+		do_psh_entire();
+		cycles += 19;
+	}
+	cc.bit.f = cc.bit.i = 1;
+	pc = load_word(0xfffc);
+}
+
+// FIRQ only stacks PC and CC, unless the HD6309 is told
+// to stack the entire state
+template <class Bus>
+void mc6809_core<Bus>::do_firq(void)
+{
+	if (waiting == wait_cwai) {
+		// nothing to stack
+	} else if (md & md_firq) {
+		do_psh_entire();
+		cycles += 19;
+	} else {
+		sync_cc();
+		cc.bit.e = 0;
+		help_psh(0x81, s, u);
+		cycles += 10;
+	}
+	cc.bit.f = cc.bit.i = 1;
+	pc = load_word(0xfff6);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::do_irq(void)
+{
+	if (waiting != wait_cwai) {
+		do_psh_entire();
+		cycles += 19;
+	}
+	cc.bit.i = 1;
+	pc = load_word(0xfff8);
+}
+
+//
+//	HD6309
+//
+
+template <class Bus>
+Word mc6809_core<Bus>::help_widen(int r)
+{
+	switch (r) {
+		case 0x08: case 0x09:
+			return d;
+		case 0x0e: case 0x0f:
+			return w;
+		case 0x0c: case 0x0d:
+			return 0;
+		case 0x0a: case 0x0b:
+			return byterefreg(r);
+	}
+	return wordrefreg(r);
+}
+
+// A 16 bit register moved into A or E gives its high byte,
+// into any other 8 bit register its low byte
+template <class Bus>
+Byte mc6809_core<Bus>::help_narrow(int r, int to)
+{
+	if (r >= 8) {
+		return byterefreg(r);
+	}
+
+	Word	val = wordrefreg(r);
+	return (to == 0x08 || to == 0x0e) ? (Byte)(val >> 8) : (Byte)val;
+}
+
+// Inter-register arithmetic, sized by the destination register
+template <class Bus>
+void mc6809_core<Bus>::help_regop(int op)
+{
+	Byte	post = fetch();
+	int	r1 = (post & 0xf0) >> 4;
+	int	r2 = (post & 0x0f) >> 0;
+
+	sync_cc();
+	if (r2 < 8) {
+		Word&	x = wordrefreg(r2);
+		Word	m = help_widen(r1);
+		DWord	t;
+
+		switch (op) {
+			case 0: t = (DWord)x + m; defer_cc(cc_add16, x, m, t); break;
+			case 1: t = (DWord)x + m + cc.bit.c; defer_cc(cc_add16, x, m, t); break;
+			case 2: t = (DWord)x - m; defer_cc(cc_sub16, x, m, t); break;
+			case 3: t = (DWord)x - m - cc.bit.c; defer_cc(cc_sub16, x, m, t); break;
+			case 4: t = x & m; defer_cc(cc_ld16, 0, 0, t); break;
+			case 5: t = x | m; defer_cc(cc_ld16, 0, 0, t); break;
+			case 6: t = x ^ m; defer_cc(cc_ld16, 0, 0, t); break;
+			default: t = (DWord)x - m; defer_cc(cc_sub16, x, m, t); break;
+		}
+		if (op != 7) {
+			x = (Word)t;
+		}
+	} else {
+		Byte&	x = byterefreg(r2);
+		Byte	m = help_narrow(r1, r2);
+		Word	t;
+
+		switch (op) {
+			case 0: t = x + m; defer_cc(cc_add8, x, m, t); break;
+			case 1: t = x + m + cc.bit.c; defer_cc(cc_add8, x, m, t); break;
+			case 2: t = x - m; defer_cc(cc_sub8, x, m, t); break;
+			case 3: t = x - m - cc.bit.c; defer_cc(cc_sub8, x, m, t); break;
+			case 4: t = x & m; defer_cc(cc_ld8, 0, 0, t); break;
+			case 5: t = x | m; defer_cc(cc_ld8, 0, 0, t); break;
+			case 6: t = x ^ m; defer_cc(cc_ld8, 0, 0, t); break;
+			default: t = x - m; defer_cc(cc_sub8, x, m, t); break;
+		}
+		// A result written to CC replaces the flags
+		if (r2 == 0x0a) {
+			sync_cc();
+		}
+		if (op != 7) {
+			x = (Byte)t;
+		}
+	}
+	zero = 0;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::add_r(void)
+{
+	help_regop(0);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::adc_r(void)
+{
+	help_regop(1);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::sub_r(void)
+{
+	help_regop(2);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::sbc_r(void)
+{
+	help_regop(3);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::and_r(void)
+{
+	help_regop(4);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::or_r(void)
+{
+	help_regop(5);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::eor_r(void)
+{
+	help_regop(6);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::cmp_r(void)
+{
+	help_regop(7);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_adc(Word& x)
+{
+	Word	m = fetch_word_operand();
+	sync_cc();
+	DWord	t = (DWord)x + m + cc.bit.c;
+
+	defer_cc(cc_add16, x, m, t);
+	x = (Word)t;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_add(Word& x)
+{
+	Word	m = fetch_word_operand();
+	DWord	t = (DWord)x + m;
+
+	defer_cc(cc_add16, x, m, t);
+	x = (Word)t;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_sbc(Word& x)
+{
+	Word	m = fetch_word_operand();
+	sync_cc();
+	long	t = x - m - cc.bit.c;
+
+	defer_cc(cc_sub16, x, m, t);
+	x = t & 0xffff;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_and(Word& x)
+{
+	x = x & fetch_word_operand();
+	defer_cc(cc_ld16, 0, 0, x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_or(Word& x)
+{
+	x = x | fetch_word_operand();
+	defer_cc(cc_ld16, 0, 0, x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_eor(Word& x)
+{
+	x = x ^ fetch_word_operand();
+	defer_cc(cc_ld16, 0, 0, x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_bit(Word x)
+{
+	Word	t = x & fetch_word_operand();
+	defer_cc(cc_ld16, 0, 0, t);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_tst(Word x)
+{
+	defer_cc(cc_ld16, 0, 0, x);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_clr(Word& x)
+{
+	sync_cc();
+	cc.all &= 0xf0;
+	cc.all |= 0x04;
+	x = 0;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_com(Word& x)
+{
+	sync_cc();
+	x = ~x;
+	cc.bit.c = 1;
+	cc.bit.v = 0;
+	cc.bit.n = btst(x, 15);
+	cc.bit.z = !x;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_neg(Word& x)
+{
+	long	t = 0 - x;
+
+	defer_cc(cc_sub16, 0, x, t);
+	x = t & 0xffff;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_inc(Word& x)
+{
+	sync_cc();
+	x = x + 1;
+	cc.bit.v = (x == 0x8000);
+	cc.bit.n = btst(x, 15);
+	cc.bit.z = !x;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_dec(Word& x)
+{
+	sync_cc();
+	x = x - 1;
+	cc.bit.v = (x == 0x7fff);
+	cc.bit.n = btst(x, 15);
+	cc.bit.z = !x;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_asr(Word& x)
+{
+	sync_cc();
+	cc.bit.c = btst(x, 0);
+	x = (x >> 1) | (x & 0x8000);
+	cc.bit.n = btst(x, 15);
+	cc.bit.z = !x;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_lsl(Word& x)
+{
+	sync_cc();
+	cc.bit.c = btst(x, 15);
+	cc.bit.v = btst(x, 15) ^ btst(x, 14);
+	x <<= 1;
+	cc.bit.n = btst(x, 15);
+	cc.bit.z = !x;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_lsr(Word& x)
+{
+	sync_cc();
+	cc.bit.c = btst(x, 0);
+	x >>= 1;
+	cc.bit.n = 0;
+	cc.bit.z = !x;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_rol(Word& x)
+{
+	sync_cc();
+	int	oc = cc.bit.c;
+	cc.bit.v = btst(x, 15) ^ btst(x, 14);
+	cc.bit.c = btst(x, 15);
+	x = x << 1;
+	if (oc) bset(x, 0);
+	cc.bit.n = btst(x, 15);
+	cc.bit.z = !x;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::help_ror(Word& x)
+{
+	sync_cc();
+	int	oc = cc.bit.c;
+	cc.bit.c = btst(x, 0);
+	x = x >> 1;
+	if (oc) bset(x, 15);
+	cc.bit.n = btst(x, 15);
+	cc.bit.z = !x;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::adcd(void)
+{
+	help_adc(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::adde(void)
+{
+	help_add(e);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::addf(void)
+{
+	help_add(f);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::addw(void)
+{
+	help_add(w);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::andd(void)
+{
+	help_and(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bitd(void)
+{
+	help_bit(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::eord(void)
+{
+	help_eor(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::ord(void)
+{
+	help_or(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::sbcd(void)
+{
+	help_sbc(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::sube(void)
+{
+	help_sub(e);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::subf(void)
+{
+	help_sub(f);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::subw(void)
+{
+	help_sub(w);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::cmpe(void)
+{
+	help_cmp(e);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::cmpf(void)
+{
+	help_cmp(f);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::cmpw(void)
+{
+	help_cmp(w);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lde(void)
+{
+	help_ld(e);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::ldf(void)
+{
+	help_ld(f);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::ldw(void)
+{
+	help_ld(w);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::ste(void)
+{
+	help_st(e);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::stf(void)
+{
+	help_st(f);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::stw(void)
+{
+	help_st(w);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::ldq(void)
+{
+	if (mode == immediate) {
+		d = fetch_word();
+		w = fetch_word();
+	} else {
+		Word	addr = fetch_effective_address();
+		d = load_word(addr);
+		w = load_word(addr + 2);
+	}
+	sync_cc();
+	cc.bit.n = btst(d, 15);
+	cc.bit.v = 0;
+	cc.bit.z = !d && !w;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::stq(void)
+{
+	Word	addr = fetch_effective_address();
+	store_word(addr, d);
+	store_word(addr + 2, w);
+	sync_cc();
+	cc.bit.n = btst(d, 15);
+	cc.bit.v = 0;
+	cc.bit.z = !d && !w;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::clrd(void)
+{
+	help_clr(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::clre(void)
+{
+	help_clr(e);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::clrf(void)
+{
+	help_clr(f);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::clrw(void)
+{
+	help_clr(w);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::comd(void)
+{
+	help_com(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::come(void)
+{
+	help_com(e);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::comf(void)
+{
+	help_com(f);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::comw(void)
+{
+	help_com(w);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::decd(void)
+{
+	help_dec(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::dece(void)
+{
+	help_dec(e);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::decf(void)
+{
+	help_dec(f);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::decw(void)
+{
+	help_dec(w);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::incd(void)
+{
+	help_inc(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::ince(void)
+{
+	help_inc(e);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::incf(void)
+{
+	help_inc(f);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::incw(void)
+{
+	help_inc(w);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::tstd(void)
+{
+	help_tst(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::tste(void)
+{
+	help_tst(e);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::tstf(void)
+{
+	help_tst(f);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::tstw(void)
+{
+	help_tst(w);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::asrd(void)
+{
+	help_asr(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lsld(void)
+{
+	help_lsl(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lsrd(void)
+{
+	help_lsr(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::lsrw(void)
+{
+	help_lsr(w);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::negd(void)
+{
+	help_neg(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::rold(void)
+{
+	help_rol(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::rolw(void)
+{
+	help_rol(w);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::rord(void)
+{
+	help_ror(d);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::rorw(void)
+{
+	help_ror(w);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::sexw(void)
+{
+	sync_cc();
+	cc.bit.n = btst(w, 15);
+	cc.bit.z = !w;
+	d = cc.bit.n ? 0xffff : 0;
+}
+
+template <class Bus>
+void mc6809_core<Bus>::pshsw(void)
+{
+	store(--s, f);
+	store(--s, e);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::pshuw(void)
+{
+	store(--u, f);
+	store(--u, e);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::pulsw(void)
+{
+	e = load(s++);
+	f = load(s++);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::puluw(void)
+{
+	e = load(u++);
+	f = load(u++);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::muld(void)
+{
+	Word	m = fetch_word_operand();
+	int32_t	t = (int32_t)(int16_t)d * (int16_t)m;
+
+	set_q((DWord)t);
+	sync_cc();
+	cc.bit.n = (t < 0);
+	cc.bit.z = (t == 0);
+	cc.bit.v = 0;
+	cc.bit.c = 0;
+}
+
+// Quotient in B, remainder in A.  A quotient that does not fit
+// leaves the registers alone and sets V.
+template <class Bus>
+void mc6809_core<Bus>::divd(void)
+{
+	int	m = (int8_t)fetch_operand();
+
+	if (m == 0) {
+		do_trap(md_divzero);
+		return;
+	}
+
+	int	n = (int16_t)d;
+	int	q = n / m;
+	int	r = n % m;
+
+	sync_cc();
+	if (q < -128 || q > 127) {
+		cc.bit.v = 1;
+		cc.bit.n = cc.bit.z = cc.bit.c = 0;
+		return;
+	}
+	b = (Byte)q;
+	a = (Byte)r;
+	cc.bit.n = btst(b, 7);
+	cc.bit.z = !b;
+	cc.bit.v = 0;
+	cc.bit.c = btst(b, 0);
+}
+
+// Quotient in W, remainder in D
+template <class Bus>
+void mc6809_core<Bus>::divq(void)
+{
+	int32_t	m = (int16_t)fetch_word_operand();
+
+	if (m == 0) {
+		do_trap(md_divzero);
+		return;
+	}
+
+	int64_t	n = (int32_t)get_q();
+	int64_t	q = n / m;
+	int64_t	r = n % m;
+
+	sync_cc();
+	if (q < -32768 || q > 32767) {
+		cc.bit.v = 1;
+		cc.bit.n = cc.bit.z = cc.bit.c = 0;
+		return;
+	}
+	w = (Word)q;
+	d = (Word)r;
+	cc.bit.n = btst(w, 15);
+	cc.bit.z = !w;
+	cc.bit.v = 0;
+	cc.bit.c = btst(w, 0);
+}
+
+// AIM, OIM, EIM and TIM: immediate byte, then the memory operand
+template <class Bus>
+void mc6809_core<Bus>::help_imm(int op)
+{
+	Byte	imm = fetch();
+	Word	addr = fetch_effective_address();
+	Byte	m = load(addr);
+
+	switch (op) {
+		case 0: m &= imm; break;
+		case 1: m |= imm; break;
+		case 2: m ^= imm; break;
+		default: m &= imm; break;
+	}
+	defer_cc(cc_ld8, 0, 0, m);
+	if (op != 3) {
+		store(addr, m);
+	}
+}
+
+template <class Bus>
+void mc6809_core<Bus>::aim(void)
+{
+	help_imm(0);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::oim(void)
+{
+	help_imm(1);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::eim(void)
+{
+	help_imm(2);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::tim(void)
+{
+	help_imm(3);
+}
+
+// Bit manipulation.  The postbyte selects CC, A or B in bits 6-7,
+// the source bit in bits 3-5 and the destination bit in bits 0-2,
+// a direct page address follows.  STBT goes from register to
+// memory, the others from memory to register.
+template <class Bus>
+void mc6809_core<Bus>::help_bitop(int op)
+{
+	Byte	post = fetch();
+	Word	addr = ((Word)dp << 8) | fetch();
+	int	sbit = (post >> 3) & 0x07;
+	int	dbit = post & 0x07;
+
+	if ((post & 0xc0) == 0xc0) {
+		invalid("bit manipulation register");
+		return;
+	}
+
+	sync_cc();
+	Byte&	r = (post & 0x80) ? b : (post & 0x40) ? a : cc.all;
+	Byte	m = load(addr);
+
+	if (op == 7) {
+		m = (m & ~(1 << dbit)) | (btst(r, sbit) << dbit);
+		store(addr, m);
+		return;
+	}
+
+	int	bit = btst(m, sbit);
+	int	t = btst(r, dbit);
+
+	switch (op) {
+		case 0: t &= bit; break;
+		case 1: t &= !bit; break;
+		case 2: t |= bit; break;
+		case 3: t |= !bit; break;
+		case 4: t ^= bit; break;
+		case 5: t ^= !bit; break;
+		default: t = bit; break;
+	}
+	r = (r & ~(1 << dbit)) | (t << dbit);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::band(void)
+{
+	help_bitop(0);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::biand(void)
+{
+	help_bitop(1);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bor(void)
+{
+	help_bitop(2);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bior(void)
+{
+	help_bitop(3);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::beor(void)
+{
+	help_bitop(4);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bieor(void)
+{
+	help_bitop(5);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::ldbt(void)
+{
+	help_bitop(6);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::stbt(void)
+{
+	help_bitop(7);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::ldmd(void)
+{
+	md = (md & ~0x03) | (fetch() & 0x03);
+}
+
+template <class Bus>
+void mc6809_core<Bus>::bitmd(void)
+{
+	Byte	t = md & fetch() & (md_illegal | md_divzero);
+
+	sync_cc();
+	cc.bit.z = !t;
+	md &= ~t;
+}
+
+// Block transfer of W bytes.  When both ranges are plain memory and
+// a host copy gives the same result as the byte-wise loop, the copy
+// is done in one go; otherwise it goes through the bus.
+template <class Bus>
+void mc6809_core<Bus>::tfm(void)
+{
+	static const int	step[4][2] = {
+		{ 1, 1 }, { -1, -1 }, { 1, 0 }, { 0, 1 }
+	};
+
+	Byte	post = fetch();
+	int	r1 = (post & 0xf0) >> 4;
+	int	r2 = (post & 0x0f) >> 0;
+
+	if (r1 > 4 || r2 > 4) {
+		invalid("transfer register");
+		return;
+	}
+
+	Word&	src = wordrefreg(r1);
+	Word&	dst = wordrefreg(r2);
+	int	kind = ir & 0x03;
+	int	sinc = step[kind][0];
+	int	dinc = step[kind][1];
+	Word	n = w;
+
+	if (n == 0) {
+		return;
+	}
+	cycles += 3 * (DWord)n;
+
+	Word	sbase = (sinc < 0) ? src - (n - 1) : src;
+	Word	dbase = (dinc < 0) ? dst - (n - 1) : dst;
+	Word	slen = sinc ? n : 1;
+	Word	dlen = dinc ? n : 1;
+	Byte	*ps = span(sbase, slen, 0);
+	Byte	*pd = ps ? span(dbase, dlen, 1) : 0;
+	int	fast = 0;
+
+	if (pd) {
+		switch (kind) {
+			case 0:
+				// Forward copy into a range just above the
+				// source replicates the leading bytes
+				if (!(pd > ps && pd < ps + n)) {
+					memmove(pd, ps, n);
+					fast = 1;
+				}
+				break;
+			case 1:
+				if (!(pd < ps && pd + n > ps)) {
+					memmove(pd, ps, n);
+					fast = 1;
+				}
+				break;
+			case 2:
+				if (pd < ps || pd >= ps + n) {
+					*pd = ps[n - 1];
+					fast = 1;
+				}
+				break;
+			case 3:
+				if (ps < pd || ps >= pd + n) {
+					memset(pd, *ps, n);
+					fast = 1;
+				}
+				break;
+		}
+	}
+
+	if (fast) {
+		src += sinc * n;
+		dst += dinc * n;
+	} else {
+		for (DWord i = 0; i < n; i++) {
+			store(dst, load(src));
+			src += sinc;
+			dst += dinc;
+		}
+	}
+	w = 0;
+}
@@ -0,0 +1,808 @@
+//
+//	mc6809op.h
+//
+//	Opcode metadata for the MC6809 and HD6309: mnemonic, addressing
+//	mode, length, base cycles and condition codes of every opcode,
+//	built at compile time. The dispatch tables, the disassembler,
+//	the profiler and the trace decoder all derive from it.
+//
+
+#ifndef __mc6809op_h__
+#define __mc6809op_h__
+
+#include "typedefs.h"
+
+//
+//	Mnemonics, each with the name of the mc6809_core member that
+//	executes it. mn_illegal must come first, so that opcodes
+//	without a definition are illegal.
+//
+
+#define MC6809_MNEMONICS(X)	\
+	X(illegal,	"???")	\
+	X(prefix10,	"PAGE2")	\
+	X(prefix11,	"PAGE3")	\
+	X(abx,		"ABX")	\
+	X(adca,		"ADCA")	\
+	X(adcb,		"ADCB")	\
+	X(adda,		"ADDA")	\
+	X(addb,		"ADDB")	\
+	X(addd,		"ADDD")	\
+	X(anda,		"ANDA")	\
+	X(andb,		"ANDB")	\
+	X(andcc,	"ANDCC")	\
+	X(asra,		"ASRA")	\
+	X(asrb,		"ASRB")	\
+	X(asr,		"ASR")	\
+	X(bcc,		"BCC")	\
+	X(bcs,		"BCS")	\
+	X(beq,		"BEQ")	\
+	X(bge,		"BGE")	\
+	X(bgt,		"BGT")	\
+	X(bhi,		"BHI")	\
+	X(bita,		"BITA")	\
+	X(bitb,		"BITB")	\
+	X(ble,		"BLE")	\
+	X(bls,		"BLS")	\
+	X(blt,		"BLT")	\
+	X(bmi,		"BMI")	\
+	X(bne,		"BNE")	\
+	X(bpl,		"BPL")	\
+	X(bra,		"BRA")	\
+	X(brn,		"BRN")	\
+	X(bsr,		"BSR")	\
+	X(bvc,		"BVC")	\
+	X(bvs,		"BVS")	\
+	X(clra,		"CLRA")	\
+	X(clrb,		"CLRB")	\
+	X(clr,		"CLR")	\
+	X(cmpa,		"CMPA")	\
+	X(cmpb,		"CMPB")	\
+	X(cmpd,		"CMPD")	\
+	X(cmps,		"CMPS")	\
+	X(cmpu,		"CMPU")	\
+	X(cmpx,		"CMPX")	\
+	X(cmpy,		"CMPY")	\
+	X(coma,		"COMA")	\
+	X(comb,		"COMB")	\
+	X(com,		"COM")	\
+	X(cwai,		"CWAI")	\
+	X(daa,		"DAA")	\
+	X(deca,		"DECA")	\
+	X(decb,		"DECB")	\
+	X(dec,		"DEC")	\
+	X(eora,		"EORA")	\
+	X(eorb,		"EORB")	\
+	X(exg,		"EXG")	\
+	X(inca,		"INCA")	\
+	X(incb,		"INCB")	\
+	X(inc,		"INC")	\
+	X(jmp,		"JMP")	\
+	X(jsr,		"JSR")	\
+	X(lbcc,		"LBCC")	\
+	X(lbcs,		"LBCS")	\
+	X(lbeq,		"LBEQ")	\
+	X(lbge,		"LBGE")	\
+	X(lbgt,		"LBGT")	\
+	X(lbhi,		"LBHI")	\
+	X(lble,		"LBLE")	\
+	X(lbls,		"LBLS")	\
+	X(lblt,		"LBLT")	\
+	X(lbmi,		"LBMI")	\
+	X(lbne,		"LBNE")	\
+	X(lbpl,		"LBPL")	\
+	X(lbra,		"LBRA")	\
+	X(lbrn,		"LBRN")	\
+	X(lbsr,		"LBSR")	\
+	X(lbvc,		"LBVC")	\
+	X(lbvs,		"LBVS")	\
+	X(lda,		"LDA")	\
+	X(ldb,		"LDB")	\
+	X(ldd,		"LDD")	\
+	X(lds,		"LDS")	\
+	X(ldu,		"LDU")	\
+	X(ldx,		"LDX")	\
+	X(ldy,		"LDY")	\
+	X(leas,		"LEAS")	\
+	X(leau,		"LEAU")	\
+	X(leax,		"LEAX")	\
+	X(leay,		"LEAY")	\
+	X(lsla,		"LSLA")	\
+	X(lslb,		"LSLB")	\
+	X(lsl,		"LSL")	\
+	X(lsra,		"LSRA")	\
+	X(lsrb,		"LSRB")	\
+	X(lsr,		"LSR")	\
+	X(mul,		"MUL")	\
+	X(nega,		"NEGA")	\
+	X(negb,		"NEGB")	\
+	X(neg,		"NEG")	\
+	X(nop,		"NOP")	\
+	X(ora,		"ORA")	\
+	X(orb,		"ORB")	\
+	X(orcc,		"ORCC")	\
+	X(pshs,		"PSHS")	\
+	X(pshu,		"PSHU")	\
+	X(puls,		"PULS")	\
+	X(pulu,		"PULU")	\
+	X(rola,		"ROLA")	\
+	X(rolb,		"ROLB")	\
+	X(rol,		"ROL")	\
+	X(rora,		"RORA")	\
+	X(rorb,		"RORB")	\
+	X(ror,		"ROR")	\
+	X(rti,		"RTI")	\
+	X(rts,		"RTS")	\
+	X(sbca,		"SBCA")	\
+	X(sbcb,		"SBCB")	\
+	X(sex,		"SEX")	\
+	X(sta,		"STA")	\
+	X(stb,		"STB")	\
+	X(std,		"STD")	\
+	X(sts,		"STS")	\
+	X(stu,		"STU")	\
+	X(stx,		"STX")	\
+	X(sty,		"STY")	\
+	X(suba,		"SUBA")	\
+	X(subb,		"SUBB")	\
+	X(subd,		"SUBD")	\
+	X(swi,		"SWI")	\
+	X(swi2,		"SWI2")	\
+	X(swi3,		"SWI3")	\
+	X(sync,		"SYNC")	\
+	X(tfr,		"TFR")	\
+	X(tsta,		"TSTA")	\
+	X(tstb,		"TSTB")	\
+	X(tst,		"TST")	\
+	X(adc_r,	"ADCR")	\
+	X(adcd,		"ADCD")	\
+	X(add_r,	"ADDR")	\
+	X(adde,		"ADDE")	\
+	X(addf,		"ADDF")	\
+	X(addw,		"ADDW")	\
+	X(aim,		"AIM")	\
+	X(and_r,	"ANDR")	\
+	X(andd,		"ANDD")	\
+	X(asrd,		"ASRD")	\
+	X(band,		"BAND")	\
+	X(beor,		"BEOR")	\
+	X(biand,	"BIAND")	\
+	X(bieor,	"BIEOR")	\
+	X(bior,		"BIOR")	\
+	X(bitd,		"BITD")	\
+	X(bitmd,	"BITMD")	\
+	X(bor,		"BOR")	\
+	X(clrd,		"CLRD")	\
+	X(clre,		"CLRE")	\
+	X(clrf,		"CLRF")	\
+	X(clrw,		"CLRW")	\
+	X(cmp_r,	"CMPR")	\
+	X(cmpe,		"CMPE")	\
+	X(cmpf,		"CMPF")	\
+	X(cmpw,		"CMPW")	\
+	X(comd,		"COMD")	\
+	X(come,		"COME")	\
+	X(comf,		"COMF")	\
+	X(comw,		"COMW")	\
+	X(decd,		"DECD")	\
+	X(dece,		"DECE")	\
+	X(decf,		"DECF")	\
+	X(decw,		"DECW")	\
+	X(divd,		"DIVD")	\
+	X(divq,		"DIVQ")	\
+	X(eim,		"EIM")	\
+	X(eor_r,	"EORR")	\
+	X(eord,		"EORD")	\
+	X(incd,		"INCD")	\
+	X(ince,		"INCE")	\
+	X(incf,		"INCF")	\
+	X(incw,		"INCW")	\
+	X(ldbt,		"LDBT")	\
+	X(lde,		"LDE")	\
+	X(ldf,		"LDF")	\
+	X(ldmd,		"LDMD")	\
+	X(ldq,		"LDQ")	\
+	X(ldw,		"LDW")	\
+	X(lsld,		"LSLD")	\
+	X(lsrd,		"LSRD")	\
+	X(lsrw,		"LSRW")	\
+	X(muld,		"MULD")	\
+	X(negd,		"NEGD")	\
+	X(oim,		"OIM")	\
+	X(or_r,		"ORR")	\
+	X(ord,		"ORD")	\
+	X(pshsw,	"PSHSW")	\
+	X(pshuw,	"PSHUW")	\
+	X(pulsw,	"PULSW")	\
+	X(puluw,	"PULUW")	\
+	X(rold,		"ROLD")	\
+	X(rolw,		"ROLW")	\
+	X(rord,		"RORD")	\
+	X(rorw,		"RORW")	\
+	X(sbc_r,	"SBCR")	\
+	X(sbcd,		"SBCD")	\
+	X(sexw,		"SEXW")	\
+	X(stbt,		"STBT")	\
+	X(ste,		"STE")	\
+	X(stf,		"STF")	\
+	X(stq,		"STQ")	\
+	X(stw,		"STW")	\
+	X(sub_r,	"SUBR")	\
+	X(sube,		"SUBE")	\
+	X(subf,		"SUBF")	\
+	X(subw,		"SUBW")	\
+	X(tfm,		"TFM")	\
+	X(tim,		"TIM")	\
+	X(tstd,		"TSTD")	\
+	X(tste,		"TSTE")	\
+	X(tstf,		"TSTF")	\
+	X(tstw,		"TSTW")
+
+enum mc6809_mnemonic {
+#define X(fn, name)	mn_##fn,
+	MC6809_MNEMONICS(X)
+#undef X
+	mn_count
+};
+
+static_assert(mn_count <= 256, "mnemonics must fit a Byte");
+
+static constexpr const char *mc6809_names[] = {
+#define X(fn, name)	name,
+	MC6809_MNEMONICS(X)
+#undef X
+};
+
+// Addressing mode the handler of an opcode works in
+enum mc6809_mode {
+	mode_immediate = 0,
+	mode_relative = 0,
+	mode_inherent,
+	mode_extended,
+	mode_direct,
+	mode_indexed
+};
+
+// Layout of the bytes following the opcode
+enum mc6809_operand {
+	opd_none,		// inherent
+	opd_imm8,		// #n
+	opd_imm16,		// #nn
+	opd_imm32,		// #nnnn (LDQ)
+	opd_rel8,		// branch offset
+	opd_rel16,		// long branch offset
+	opd_direct,		// <n
+	opd_indexed,		// postbyte and its offset
+	opd_extended,		// nn
+	opd_regs,		// TFR, EXG and register to register postbyte
+	opd_stack_s,		// PSHS/PULS register list
+	opd_stack_u,		// PSHU/PULU register list
+	opd_imm_direct,		// #n,<n (AIM, OIM, EIM, TIM)
+	opd_imm_indexed,	// #n, postbyte and its offset
+	opd_imm_extended,	// #n,nn
+	opd_bit,		// register bit postbyte, <n
+	opd_tfm,		// TFM register postbyte
+	opd_count
+};
+
+// Condition code bits
+enum {
+	ccf_c = 0x01,
+	ccf_v = 0x02,
+	ccf_z = 0x04,
+	ccf_n = 0x08,
+	ccf_i = 0x10,
+	ccf_h = 0x20,
+	ccf_f = 0x40,
+	ccf_e = 0x80,
+	ccf_nz = ccf_n | ccf_z,
+	ccf_nzv = ccf_n | ccf_z | ccf_v,
+	ccf_nzc = ccf_n | ccf_z | ccf_c,
+	ccf_nzvc = ccf_n | ccf_z | ccf_v | ccf_c,
+	ccf_hnzvc = ccf_h | ccf_nzvc,
+	ccf_all = 0xff
+};
+
+// Everything known about one opcode
+struct mc6809_opinfo {
+	Byte			mnemonic;	// mc6809_mnemonic
+	Byte			page;		// Prefix: 0x10, 0x11 or 0
+	Byte			mode;		// mc6809_mode
+	Byte			operand;	// mc6809_operand
+	Byte			len;		// Bytes, without the indexed offset
+	Byte			cycles;		// Base cycle count
+	Byte			ccread;		// Condition codes used
+	Byte			ccwrite;	// Condition codes changed
+};
+
+//
+//	Opcode definitions, as in the datasheets. One definition may
+//	cover several addressing modes of the same instruction.
+//	Instructions whose postbyte may name CC count all of it as
+//	read or written.
+//
+
+enum {
+	cpu_6809 = 0x01,	// MC6809 only, undocumented opcodes
+	cpu_6309 = 0x02,	// HD6309 only
+	cpu_both = 0x03
+};
+
+enum {
+	form_one,		// code, with the given operand
+	form_alu,		// code immediate, +0x10 direct, +0x20 indexed, +0x30 extended
+	form_mem,		// form_alu without the immediate
+	form_rmw		// code direct, +0x60 indexed, +0x70 extended
+};
+
+struct mc6809_opdef {
+	Word			code;		// Opcode, with any prefix in the high byte
+	Byte			mnemonic;
+	Byte			form;
+	Byte			operand;	// form_alu: the immediate, form_rmw: opd_imm8 for AIM and friends
+	Byte			cpu;
+	Byte			ccread;
+	Byte			ccwrite;
+};
+
+static constexpr mc6809_opdef	mc6809_opdefs[] = {
+	{ 0x10,   mn_prefix10, form_one, opd_none,     cpu_both, 0,               0 },
+	{ 0x11,   mn_prefix11, form_one, opd_none,     cpu_both, 0,               0 },
+	{ 0x3a,   mn_abx,      form_one, opd_none,     cpu_both, 0,               0 },
+	{ 0x89,   mn_adca,     form_alu, opd_imm8,     cpu_both, ccf_c,           ccf_hnzvc },
+	{ 0xc9,   mn_adcb,     form_alu, opd_imm8,     cpu_both, ccf_c,           ccf_hnzvc },
+	{ 0x8b,   mn_adda,     form_alu, opd_imm8,     cpu_both, 0,               ccf_hnzvc },
+	{ 0xcb,   mn_addb,     form_alu, opd_imm8,     cpu_both, 0,               ccf_hnzvc },
+	{ 0xc3,   mn_addd,     form_alu, opd_imm16,    cpu_both, 0,               ccf_nzvc },
+	{ 0x84,   mn_anda,     form_alu, opd_imm8,     cpu_both, 0,               ccf_nzv },
+	{ 0xc4,   mn_andb,     form_alu, opd_imm8,     cpu_both, 0,               ccf_nzv },
+	{ 0x1c,   mn_andcc,    form_one, opd_imm8,     cpu_both, ccf_all,         ccf_all },
+	{ 0x47,   mn_asra,     form_one, opd_none,     cpu_both, 0,               ccf_nzc },
+	{ 0x57,   mn_asrb,     form_one, opd_none,     cpu_both, 0,               ccf_nzc },
+	{ 0x07,   mn_asr,      form_rmw, opd_none,     cpu_both, 0,               ccf_nzc },
+	{ 0x20,   mn_bra,      form_one, opd_rel8,     cpu_both, 0,               0 },
+	{ 0x21,   mn_brn,      form_one, opd_rel8,     cpu_both, 0,               0 },
+	{ 0x22,   mn_bhi,      form_one, opd_rel8,     cpu_both, ccf_c | ccf_z,   0 },
+	{ 0x23,   mn_bls,      form_one, opd_rel8,     cpu_both, ccf_c | ccf_z,   0 },
+	{ 0x24,   mn_bcc,      form_one, opd_rel8,     cpu_both, ccf_c,           0 },
+	{ 0x25,   mn_bcs,      form_one, opd_rel8,     cpu_both, ccf_c,           0 },
+	{ 0x26,   mn_bne,      form_one, opd_rel8,     cpu_both, ccf_z,           0 },
+	{ 0x27,   mn_beq,      form_one, opd_rel8,     cpu_both, ccf_z,           0 },
+	{ 0x28,   mn_bvc,      form_one, opd_rel8,     cpu_both, ccf_v,           0 },
+	{ 0x29,   mn_bvs,      form_one, opd_rel8,     cpu_both, ccf_v,           0 },
+	{ 0x2a,   mn_bpl,      form_one, opd_rel8,     cpu_both, ccf_n,           0 },
+	{ 0x2b,   mn_bmi,      form_one, opd_rel8,     cpu_both, ccf_n,           0 },
+	{ 0x2c,   mn_bge,      form_one, opd_rel8,     cpu_both, ccf_n | ccf_v,   0 },
+	{ 0x2d,   mn_blt,      form_one, opd_rel8,     cpu_both, ccf_n | ccf_v,   0 },
+	{ 0x2e,   mn_bgt,      form_one, opd_rel8,     cpu_both, ccf_nzv,         0 },
+	{ 0x2f,   mn_ble,      form_one, opd_rel8,     cpu_both, ccf_nzv,         0 },
+	{ 0x8d,   mn_bsr,      form_one, opd_rel8,     cpu_both, 0,               0 },
+	{ 0x16,   mn_lbra,     form_one, opd_rel16,    cpu_both, 0,               0 },
+	{ 0x17,   mn_lbsr,     form_one, opd_rel16,    cpu_both, 0,               0 },
+	{ 0x1021, mn_lbrn,     form_one, opd_rel16,    cpu_both, 0,               0 },
+	{ 0x1022, mn_lbhi,     form_one, opd_rel16,    cpu_both, ccf_c | ccf_z,   0 },
+	{ 0x1023, mn_lbls,     form_one, opd_rel16,    cpu_both, ccf_c | ccf_z,   0 },
+	{ 0x1024, mn_lbcc,     form_one, opd_rel16,    cpu_both, ccf_c,           0 },
+	{ 0x1025, mn_lbcs,     form_one, opd_rel16,    cpu_both, ccf_c,           0 },
+	{ 0x1026, mn_lbne,     form_one, opd_rel16,    cpu_both, ccf_z,           0 },
+	{ 0x1027, mn_lbeq,     form_one, opd_rel16,    cpu_both, ccf_z,           0 },
+	{ 0x1028, mn_lbvc,     form_one, opd_rel16,    cpu_both, ccf_v,           0 },
+	{ 0x1029, mn_lbvs,     form_one, opd_rel16,    cpu_both, ccf_v,           0 },
+	{ 0x102a, mn_lbpl,     form_one, opd_rel16,    cpu_both, ccf_n,           0 },
+	{ 0x102b, mn_lbmi,     form_one, opd_rel16,    cpu_both, ccf_n,           0 },
+	{ 0x102c, mn_lbge,     form_one, opd_rel16,    cpu_both, ccf_n | ccf_v,   0 },
+	{ 0x102d, mn_lblt,     form_one, opd_rel16,    cpu_both, ccf_n | ccf_v,   0 },
+	{ 0x102e, mn_lbgt,     form_one, opd_rel16,    cpu_both, ccf_nzv,         0 },
+	{ 0x102f, mn_lble,     form_one, opd_rel16,    cpu_both, ccf_nzv,         0 },
+	{ 0x85,   mn_bita,     form_alu, opd_imm8,     cpu_both, 0,               ccf_nzv },
+	{ 0xc5,   mn_bitb,     form_alu, opd_imm8,     cpu_both, 0,               ccf_nzv },
+	{ 0x4f,   mn_clra,     form_one, opd_none,     cpu_both, 0,               ccf_nzvc },
+	{ 0x5f,   mn_clrb,     form_one, opd_none,     cpu_both, 0,               ccf_nzvc },
+	{ 0x0f,   mn_clr,      form_rmw, opd_none,     cpu_both, 0,               ccf_nzvc },
+	{ 0x81,   mn_cmpa,     form_alu, opd_imm8,     cpu_both, 0,               ccf_nzvc },
+	{ 0xc1,   mn_cmpb,     form_alu, opd_imm8,     cpu_both, 0,               ccf_nzvc },
+	{ 0x1083, mn_cmpd,     form_alu, opd_imm16,    cpu_both, 0,               ccf_nzvc },
+	{ 0x118c, mn_cmps,     form_alu, opd_imm16,    cpu_both, 0,               ccf_nzvc },
+	{ 0x1183, mn_cmpu,     form_alu, opd_imm16,    cpu_both, 0,               ccf_nzvc },
+	{ 0x8c,   mn_cmpx,     form_alu, opd_imm16,    cpu_both, 0,               ccf_nzvc },
+	{ 0x108c, mn_cmpy,     form_alu, opd_imm16,    cpu_both, 0,               ccf_nzvc },
+	{ 0x43,   mn_coma,     form_one, opd_none,     cpu_both, 0,               ccf_nzvc },
+	{ 0x53,   mn_comb,     form_one, opd_none,     cpu_both, 0,               ccf_nzvc },
+	{ 0x03,   mn_com,      form_rmw, opd_none,     cpu_both, 0,               ccf_nzvc },
+	{ 0x3c,   mn_cwai,     form_one, opd_imm8,     cpu_both, ccf_all,         ccf_all },
+	{ 0x19,   mn_daa,      form_one, opd_none,     cpu_both, ccf_h | ccf_c,   ccf_nzvc },
+	{ 0x4a,   mn_deca,     form_one, opd_none,     cpu_both, 0,               ccf_nzv },
+	{ 0x5a,   mn_decb,     form_one, opd_none,     cpu_both, 0,               ccf_nzv },
+	{ 0x0a,   mn_dec,      form_rmw, opd_none,     cpu_both, 0,               ccf_nzv },
+	{ 0x88,   mn_eora,     form_alu, opd_imm8,     cpu_both, 0,               ccf_nzv },
+	{ 0xc8,   mn_eorb,     form_alu, opd_imm8,     cpu_both, 0,               ccf_nzv },
+	{ 0x1e,   mn_exg,      form_one, opd_regs,     cpu_both, ccf_all,         ccf_all },
+	{ 0x4c,   mn_inca,     form_one, opd_none,     cpu_both, 0,               ccf_nzv },
+	{ 0x5c,   mn_incb,     form_one, opd_none,     cpu_both, 0,               ccf_nzv },
+	{ 0x0c,   mn_inc,      form_rmw, opd_none,     cpu_both, 0,               ccf_nzv },
+	{ 0x0e,   mn_jmp,      form_rmw, opd_none,     cpu_both, 0,               0 },
+	{ 0x8d,   mn_jsr,      form_mem, opd_none,     cpu_both, 0,               0 },
+	{ 0x86,   mn_lda,      form_alu, opd_imm8,     cpu_both, 0,               ccf_nzv },
+	{ 0xc6,   mn_ldb,      form_alu, opd_imm8,     cpu_both, 0,               ccf_nzv },
+	{ 0xcc,   mn_ldd,      form_alu, opd_imm16,    cpu_both, 0,               ccf_nzv },
+	{ 0x10ce, mn_lds,      form_alu, opd_imm16,    cpu_both, 0,               ccf_nzv },
+	{ 0xce,   mn_ldu,      form_alu, opd_imm16,    cpu_both, 0,               ccf_nzv },
+	{ 0x8e,   mn_ldx,      form_alu, opd_imm16,    cpu_both, 0,               ccf_nzv },
+	{ 0x108e, mn_ldy,      form_alu, opd_imm16,    cpu_both, 0,               ccf_nzv },
+	{ 0x30,   mn_leax,     form_one, opd_indexed,  cpu_both, 0,               ccf_z },
+	{ 0x31,   mn_leay,     form_one, opd_indexed,  cpu_both, 0,               ccf_z },
+	{ 0x32,   mn_leas,     form_one, opd_indexed,  cpu_both, 0,               0 },
+	{ 0x33,   mn_leau,     form_one, opd_indexed,  cpu_both, 0,               0 },
+	{ 0x48,   mn_lsla,     form_one, opd_none,     cpu_both, 0,               ccf_nzvc },
+	{ 0x58,   mn_lslb,     form_one, opd_none,     cpu_both, 0,               ccf_nzvc },
+	{ 0x08,   mn_lsl,      form_rmw, opd_none,     cpu_both, 0,               ccf_nzvc },
+	{ 0x44,   mn_lsra,     form_one, opd_none,     cpu_both, 0,               ccf_nzc },
+	{ 0x54,   mn_lsrb,     form_one, opd_none,     cpu_both, 0,               ccf_nzc },
+	{ 0x04,   mn_lsr,      form_rmw, opd_none,     cpu_both, 0,               ccf_nzc },
+	{ 0x3d,   mn_mul,      form_one, opd_none,     cpu_both, 0,               ccf_z | ccf_c },
+	{ 0x40,   mn_nega,     form_one, opd_none,     cpu_both, 0,               ccf_nzvc },
+	{ 0x50,   mn_negb,     form_one, opd_none,     cpu_both, 0,               ccf_nzvc },
+	{ 0x00,   mn_neg,      form_rmw, opd_none,     cpu_both, 0,               ccf_nzvc },
+	{ 0x12,   mn_nop,      form_one, opd_none,     cpu_both, 0,               0 },
+	{ 0x8a,   mn_ora,      form_alu, opd_imm8,     cpu_both, 0,               ccf_nzv },
+	{ 0xca,   mn_orb,      form_alu, opd_imm8,     cpu_both, 0,               ccf_nzv },
+	{ 0x1a,   mn_orcc,     form_one, opd_imm8,     cpu_both, ccf_all,         ccf_all },
+	{ 0x34,   mn_pshs,     form_one, opd_stack_s,  cpu_both, ccf_all,         0 },
+	{ 0x35,   mn_puls,     form_one, opd_stack_s,  cpu_both, 0,               ccf_all },
+	{ 0x36,   mn_pshu,     form_one, opd_stack_u,  cpu_both, ccf_all,         0 },
+	{ 0x37,   mn_pulu,     form_one, opd_stack_u,  cpu_both, 0,               ccf_all },
+	{ 0x49,   mn_rola,     form_one, opd_none,     cpu_both, ccf_c,           ccf_nzvc },
+	{ 0x59,   mn_rolb,     form_one, opd_none,     cpu_both, ccf_c,           ccf_nzvc },
+	{ 0x09,   mn_rol,      form_rmw, opd_none,     cpu_both, ccf_c,           ccf_nzvc },
+	{ 0x46,   mn_rora,     form_one, opd_none,     cpu_both, ccf_c,           ccf_nzc },
+	{ 0x56,   mn_rorb,     form_one, opd_none,     cpu_both, ccf_c,           ccf_nzc },
+	{ 0x06,   mn_ror,      form_rmw, opd_none,     cpu_both, ccf_c,           ccf_nzc },
+	{ 0x3b,   mn_rti,      form_one, opd_none,     cpu_both, 0,               ccf_all },
+	{ 0x39,   mn_rts,      form_one, opd_none,     cpu_both, 0,               0 },
+	{ 0x82,   mn_sbca,     form_alu, opd_imm8,     cpu_both, ccf_c,           ccf_nzvc },
+	{ 0xc2,   mn_sbcb,     form_alu, opd_imm8,     cpu_both, ccf_c,           ccf_nzvc },
+	{ 0x1d,   mn_sex,      form_one, opd_none,     cpu_both, 0,               ccf_nz },
+	{ 0x87,   mn_sta,      form_mem, opd_none,     cpu_both, 0,               ccf_nzv },
+	{ 0xc7,   mn_stb,      form_mem, opd_none,     cpu_both, 0,               ccf_nzv },
+	{ 0xcd,   mn_std,      form_mem, opd_none,     cpu_both, 0,               ccf_nzv },
+	{ 0x10cf, mn_sts,      form_mem, opd_none,     cpu_both, 0,               ccf_nzv },
+	{ 0xcf,   mn_stu,      form_mem, opd_none,     cpu_both, 0,               ccf_nzv },
+	{ 0x8f,   mn_stx,      form_mem, opd_none,     cpu_both, 0,               ccf_nzv },
+	{ 0x108f, mn_sty,      form_mem, opd_none,     cpu_both, 0,               ccf_nzv },
+	{ 0x80,   mn_suba,     form_alu, opd_imm8,     cpu_both, 0,               ccf_nzvc },
+	{ 0xc0,   mn_subb,     form_alu, opd_imm8,     cpu_both, 0,               ccf_nzvc },
+	{ 0x83,   mn_subd,     form_alu, opd_imm16,    cpu_both, 0,               ccf_nzvc },
+	{ 0x3f,   mn_swi,      form_one, opd_none,     cpu_both, ccf_all,         ccf_e | ccf_f | ccf_i },
+	{ 0x103f, mn_swi2,     form_one, opd_none,     cpu_both, ccf_all,         ccf_e },
+	{ 0x113f, mn_swi3,     form_one, opd_none,     cpu_both, ccf_all,         ccf_e },
+	{ 0x13,   mn_sync,     form_one, opd_none,     cpu_both, 0,               0 },
+	{ 0x1f,   mn_tfr,      form_one, opd_regs,     cpu_both, ccf_all,         ccf_all },
+	{ 0x4d,   mn_tsta,     form_one, opd_none,     cpu_both, 0,               ccf_nzv },
+	{ 0x5d,   mn_tstb,     form_one, opd_none,     cpu_both, 0,               ccf_nzv },
+	{ 0x0d,   mn_tst,      form_rmw, opd_none,     cpu_both, 0,               ccf_nzv },
+
+	// Undocumented MC6809 opcodes, illegal on the HD6309
+	{ 0x01,   mn_neg,      form_rmw, opd_none,     cpu_6809, 0,               ccf_nzvc },
+	{ 0x05,   mn_lsr,      form_rmw, opd_none,     cpu_6809, 0,               ccf_nzc },
+	{ 0x0b,   mn_dec,      form_rmw, opd_none,     cpu_6809, 0,               ccf_nzv },
+	{ 0x41,   mn_nega,     form_one, opd_none,     cpu_6809, 0,               ccf_nzvc },
+	{ 0x42,   mn_coma,     form_one, opd_none,     cpu_6809, 0,               ccf_nzvc },
+	{ 0x45,   mn_lsra,     form_one, opd_none,     cpu_6809, 0,               ccf_nzc },
+	{ 0x4b,   mn_deca,     form_one, opd_none,     cpu_6809, 0,               ccf_nzv },
+	{ 0x4e,   mn_clra,     form_one, opd_none,     cpu_6809, 0,               ccf_nzvc },
+	{ 0x51,   mn_negb,     form_one, opd_none,     cpu_6809, 0,               ccf_nzvc },
+	{ 0x52,   mn_comb,     form_one, opd_none,     cpu_6809, 0,               ccf_nzvc },
+	{ 0x55,   mn_lsrb,     form_one, opd_none,     cpu_6809, 0,               ccf_nzc },
+	{ 0x5b,   mn_decb,     form_one, opd_none,     cpu_6809, 0,               ccf_nzv },
+	{ 0x5e,   mn_clrb,     form_one, opd_none,     cpu_6809, 0,               ccf_nzvc },
+	{ 0x62,   mn_com,      form_one, opd_indexed,  cpu_6809, 0,               ccf_nzvc },
+	{ 0x1042, mn_coma,     form_one, opd_none,     cpu_6809, 0,               ccf_nzvc },
+
+	// HD6309 only
+	{ 0x1030, mn_add_r,    form_one, opd_regs,     cpu_6309, ccf_all,         ccf_all },
+	{ 0x1031, mn_adc_r,    form_one, opd_regs,     cpu_6309, ccf_all,         ccf_all },
+	{ 0x1032, mn_sub_r,    form_one, opd_regs,     cpu_6309, ccf_all,         ccf_all },
+	{ 0x1033, mn_sbc_r,    form_one, opd_regs,     cpu_6309, ccf_all,         ccf_all },
+	{ 0x1034, mn_and_r,    form_one, opd_regs,     cpu_6309, ccf_all,         ccf_all },
+	{ 0x1035, mn_or_r,     form_one, opd_regs,     cpu_6309, ccf_all,         ccf_all },
+	{ 0x1036, mn_eor_r,    form_one, opd_regs,     cpu_6309, ccf_all,         ccf_all },
+	{ 0x1037, mn_cmp_r,    form_one, opd_regs,     cpu_6309, ccf_all,         ccf_all },
+	{ 0x1089, mn_adcd,     form_alu, opd_imm16,    cpu_6309, ccf_c,           ccf_nzvc },
+	{ 0x118b, mn_adde,     form_alu, opd_imm8,     cpu_6309, 0,               ccf_hnzvc },
+	{ 0x11cb, mn_addf,     form_alu, opd_imm8,     cpu_6309, 0,               ccf_hnzvc },
+	{ 0x108b, mn_addw,     form_alu, opd_imm16,    cpu_6309, 0,               ccf_nzvc },
+	{ 0x02,   mn_aim,      form_rmw, opd_imm8,     cpu_6309, 0,               ccf_nzv },
+	{ 0x01,   mn_oim,      form_rmw, opd_imm8,     cpu_6309, 0,               ccf_nzv },
+	{ 0x05,   mn_eim,      form_rmw, opd_imm8,     cpu_6309, 0,               ccf_nzv },
+	{ 0x0b,   mn_tim,      form_rmw, opd_imm8,     cpu_6309, 0,               ccf_nzv },
+	{ 0x1084, mn_andd,     form_alu, opd_imm16,    cpu_6309, 0,               ccf_nzv },
+	{ 0x1047, mn_asrd,     form_one, opd_none,     cpu_6309, 0,               ccf_nzc },
+	{ 0x1130, mn_band,     form_one, opd_bit,      cpu_6309, ccf_all,         ccf_all },
+	{ 0x1131, mn_biand,    form_one, opd_bit,      cpu_6309, ccf_all,         ccf_all },
+	{ 0x1132, mn_bor,      form_one, opd_bit,      cpu_6309, ccf_all,         ccf_all },
+	{ 0x1133, mn_bior,     form_one, opd_bit,      cpu_6309, ccf_all,         ccf_all },
+	{ 0x1134, mn_beor,     form_one, opd_bit,      cpu_6309, ccf_all,         ccf_all },
+	{ 0x1135, mn_bieor,    form_one, opd_bit,      cpu_6309, ccf_all,         ccf_all },
+	{ 0x1136, mn_ldbt,     form_one, opd_bit,      cpu_6309, 0,               ccf_all },
+	{ 0x1137, mn_stbt,     form_one, opd_bit,      cpu_6309, ccf_all,         0 },
+	{ 0x1085, mn_bitd,     form_alu, opd_imm16,    cpu_6309, 0,               ccf_nzv },
+	{ 0x113c, mn_bitmd,    form_one, opd_imm8,     cpu_6309, 0,               ccf_z },
+	{ 0x104f, mn_clrd,     form_one, opd_none,     cpu_6309, 0,               ccf_nzvc },
+	{ 0x114f, mn_clre,     form_one, opd_none,     cpu_6309, 0,               ccf_nzvc },
+	{ 0x115f, mn_clrf,     form_one, opd_none,     cpu_6309, 0,               ccf_nzvc },
+	{ 0x105f, mn_clrw,     form_one, opd_none,     cpu_6309, 0,               ccf_nzvc },
+	{ 0x1181, mn_cmpe,     form_alu, opd_imm8,     cpu_6309, 0,               ccf_nzvc },
+	{ 0x11c1, mn_cmpf,     form_alu, opd_imm8,     cpu_6309, 0,               ccf_nzvc },
+	{ 0x1081, mn_cmpw,     form_alu, opd_imm16,    cpu_6309, 0,               ccf_nzvc },
+	{ 0x1043, mn_comd,     form_one, opd_none,     cpu_6309, 0,               ccf_nzvc },
+	{ 0x1143, mn_come,     form_one, opd_none,     cpu_6309, 0,               ccf_nzvc },
+	{ 0x1153, mn_comf,     form_one, opd_none,     cpu_6309, 0,               ccf_nzvc },
+	{ 0x1053, mn_comw,     form_one, opd_none,     cpu_6309, 0,               ccf_nzvc },
+	{ 0x104a, mn_decd,     form_one, opd_none,     cpu_6309, 0,               ccf_nzv },
+	{ 0x114a, mn_dece,     form_one, opd_none,     cpu_6309, 0,               ccf_nzv },
+	{ 0x115a, mn_decf,     form_one, opd_none,     cpu_6309, 0,               ccf_nzv },
+	{ 0x105a, mn_decw,     form_one, opd_none,     cpu_6309, 0,               ccf_nzv },
+	{ 0x118d, mn_divd,     form_alu, opd_imm8,     cpu_6309, 0,               ccf_nzvc },
+	{ 0x118e, mn_divq,     form_alu, opd_imm16,    cpu_6309, 0,               ccf_nzvc },
+	{ 0x1088, mn_eord,     form_alu, opd_imm16,    cpu_6309, 0,               ccf_nzv },
+	{ 0x104c, mn_incd,     form_one, opd_none,     cpu_6309, 0,               ccf_nzv },
+	{ 0x114c, mn_ince,     form_one, opd_none,     cpu_6309, 0,               ccf_nzv },
+	{ 0x115c, mn_incf,     form_one, opd_none,     cpu_6309, 0,               ccf_nzv },
+	{ 0x105c, mn_incw,     form_one, opd_none,     cpu_6309, 0,               ccf_nzv },
+	{ 0x113d, mn_ldmd,     form_one, opd_imm8,     cpu_6309, 0,               0 },
+	{ 0x1186, mn_lde,      form_alu, opd_imm8,     cpu_6309, 0,               ccf_nzv },
+	{ 0x11c6, mn_ldf,      form_alu, opd_imm8,     cpu_6309, 0,               ccf_nzv },
+	{ 0xcd,   mn_ldq,      form_one, opd_imm32,    cpu_6309, 0,               ccf_nzv },
+	{ 0x10cc, mn_ldq,      form_mem, opd_none,     cpu_6309, 0,               ccf_nzv },
+	{ 0x1086, mn_ldw,      form_alu, opd_imm16,    cpu_6309, 0,               ccf_nzv },
+	{ 0x1048, mn_lsld,     form_one, opd_none,     cpu_6309, 0,               ccf_nzvc },
+	{ 0x1044, mn_lsrd,     form_one, opd_none,     cpu_6309, 0,               ccf_nzc },
+	{ 0x1054, mn_lsrw,     form_one, opd_none,     cpu_6309, 0,               ccf_nzc },
+	{ 0x118f, mn_muld,     form_alu, opd_imm16,    cpu_6309, 0,               ccf_nz },
+	{ 0x1040, mn_negd,     form_one, opd_none,     cpu_6309, 0,               ccf_nzvc },
+	{ 0x108a, mn_ord,      form_alu, opd_imm16,    cpu_6309, 0,               ccf_nzv },
+	{ 0x1038, mn_pshsw,    form_one, opd_none,     cpu_6309, 0,               0 },
+	{ 0x1039, mn_pulsw,    form_one, opd_none,     cpu_6309, 0,               0 },
+	{ 0x103a, mn_pshuw,    form_one, opd_none,     cpu_6309, 0,               0 },
+	{ 0x103b, mn_puluw,    form_one, opd_none,     cpu_6309, 0,               0 },
+	{ 0x1049, mn_rold,     form_one, opd_none,     cpu_6309, ccf_c,           ccf_nzvc },
+	{ 0x1059, mn_rolw,     form_one, opd_none,     cpu_6309, ccf_c,           ccf_nzvc },
+	{ 0x1046, mn_rord,     form_one, opd_none,     cpu_6309, ccf_c,           ccf_nzc },
+	{ 0x1056, mn_rorw,     form_one, opd_none,     cpu_6309, ccf_c,           ccf_nzc },
+	{ 0x1082, mn_sbcd,     form_alu, opd_imm16,    cpu_6309, ccf_c,           ccf_nzvc },
+	{ 0x14,   mn_sexw,     form_one, opd_none,     cpu_6309, 0,               ccf_nz },
+	{ 0x1187, mn_ste,      form_mem, opd_none,     cpu_6309, 0,               ccf_nzv },
+	{ 0x11c7, mn_stf,      form_mem, opd_none,     cpu_6309, 0,               ccf_nzv },
+	{ 0x10cd, mn_stq,      form_mem, opd_none,     cpu_6309, 0,               ccf_nzv },
+	{ 0x1087, mn_stw,      form_mem, opd_none,     cpu_6309, 0,               ccf_nzv },
+	{ 0x1180, mn_sube,     form_alu, opd_imm8,     cpu_6309, 0,               ccf_nzvc },
+	{ 0x11c0, mn_subf,     form_alu, opd_imm8,     cpu_6309, 0,               ccf_nzvc },
+	{ 0x1080, mn_subw,     form_alu, opd_imm16,    cpu_6309, 0,               ccf_nzvc },
+	{ 0x1138, mn_tfm,      form_one, opd_tfm,      cpu_6309, 0,               0 },
+	{ 0x1139, mn_tfm,      form_one, opd_tfm,      cpu_6309, 0,               0 },
+	{ 0x113a, mn_tfm,      form_one, opd_tfm,      cpu_6309, 0,               0 },
+	{ 0x113b, mn_tfm,      form_one, opd_tfm,      cpu_6309, 0,               0 },
+	{ 0x104d, mn_tstd,     form_one, opd_none,     cpu_6309, 0,               ccf_nzv },
+	{ 0x114d, mn_tste,     form_one, opd_none,     cpu_6309, 0,               ccf_nzv },
+	{ 0x115d, mn_tstf,     form_one, opd_none,     cpu_6309, 0,               ccf_nzv },
+	{ 0x105d, mn_tstw,     form_one, opd_none,     cpu_6309, 0,               ccf_nzv }
+};
+
+//----------------------------------------------------------------------------
+// Cycle counts
+//
+// Base counts are taken from the datasheets, for the HD6309 those of
+// emulation mode; native mode timing is not modelled. Indexed modes
+// add the postbyte extras from idxcycles, PSH/PUL add one cycle per
+// byte moved, taken long branches add one cycle, RTI adds nine when
+// the entire state was stacked and TFM three per byte moved.
+//----------------------------------------------------------------------------
+static constexpr Byte	mc6809_cycles0[2][256] = {
+{
+//	 0  1  2  3  4  5  6  7  8  9  a  b  c  d  e  f		MC6809
+	 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 3, 6,	// 0x00
+	 0, 0, 2, 4, 0, 0, 5, 9, 0, 2, 3, 0, 3, 2, 8, 6,	// 0x10
+	 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,	// 0x20
+	 4, 4, 4, 4, 5, 5, 5, 5, 0, 5, 3, 6,20,11, 0,19,	// 0x30
+	 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,	// 0x40
+	 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,	// 0x50
+	 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 3, 6,	// 0x60
+	 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 4, 7,	// 0x70
+	 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 2, 4, 7, 3, 2,	// 0x80
+	 4, 4, 4, 6, 4, 4, 4, 4, 4, 4, 4, 4, 6, 7, 5, 5,	// 0x90
+	 4, 4, 4, 6, 4, 4, 4, 4, 4, 4, 4, 4, 6, 7, 5, 5,	// 0xa0
+	 5, 5, 5, 7, 5, 5, 5, 5, 5, 5, 5, 5, 7, 8, 6, 6,	// 0xb0
+	 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 3, 2,	// 0xc0
+	 4, 4, 4, 6, 4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5,	// 0xd0
+	 4, 4, 4, 6, 4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5,	// 0xe0
+	 5, 5, 5, 7, 5, 5, 5, 5, 5, 5, 5, 5, 6, 6, 6, 6	// 0xf0
+}, {
+//	 0  1  2  3  4  5  6  7  8  9  a  b  c  d  e  f		HD6309
+	 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 4, 6, 6, 3, 6,	// 0x00
+	 0, 0, 2, 4, 4, 0, 5, 9, 0, 2, 3, 0, 3, 2, 8, 6,	// 0x10
+	 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,	// 0x20
+	 4, 4, 4, 4, 5, 5, 5, 5, 0, 5, 3, 6,20,11, 0,19,	// 0x30
+	 2, 0, 0, 2, 2, 0, 2, 2, 2, 2, 2, 0, 2, 2, 0, 2,	// 0x40
+	 2, 0, 0, 2, 2, 0, 2, 2, 2, 2, 2, 0, 2, 2, 0, 2,	// 0x50
+	 6, 7, 7, 6, 6, 7, 6, 6, 6, 6, 6, 7, 6, 6, 3, 6,	// 0x60
+	 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 5, 7, 7, 4, 7,	// 0x70
+	 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 2, 4, 7, 3, 2,	// 0x80
+	 4, 4, 4, 6, 4, 4, 4, 4, 4, 4, 4, 4, 6, 7, 5, 5,	// 0x90
+	 4, 4, 4, 6, 4, 4, 4, 4, 4, 4, 4, 4, 6, 7, 5, 5,	// 0xa0
+	 5, 5, 5, 7, 5, 5, 5, 5, 5, 5, 5, 5, 7, 8, 6, 6,	// 0xb0
+	 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 2, 3, 5, 3, 2,	// 0xc0
+	 4, 4, 4, 6, 4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5,	// 0xd0
+	 4, 4, 4, 6, 4, 4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5,	// 0xe0
+	 5, 5, 5, 7, 5, 5, 5, 5, 5, 5, 5, 5, 6, 6, 6, 6	// 0xf0
+} };
+
+static constexpr Byte	mc6809_cycles10[256] = {
+//	 0  1  2  3  4  5  6  7  8  9  a  b  c  d  e  f
+	 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,	// 0x00
+	 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,	// 0x10
+	 0, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,	// 0x20
+	 4, 4, 4, 4, 4, 4, 4, 4, 6, 6, 6, 6, 0, 0, 0,20,	// 0x30
+	 3, 0, 2, 3, 3, 0, 3, 3, 3, 3, 3, 0, 3, 3, 0, 3,	// 0x40
+	 0, 0, 0, 3, 3, 0, 3, 0, 0, 3, 3, 0, 3, 3, 0, 3,	// 0x50
+	 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,	// 0x60
+	 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,	// 0x70
+	 5, 5, 5, 5, 5, 5, 4, 0, 5, 5, 5, 5, 5, 0, 4, 0,	// 0x80
+	 7, 7, 7, 7, 7, 7, 6, 6, 7, 7, 7, 7, 7, 0, 6, 6,	// 0x90
+	 7, 7, 7, 7, 7, 7, 6, 6, 7, 7, 7, 7, 7, 0, 6, 6,	// 0xa0
+	 8, 8, 8, 8, 8, 8, 7, 7, 8, 8, 8, 8, 8, 0, 7, 7,	// 0xb0
+	 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 0,	// 0xc0
+	 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 8, 8, 6, 6,	// 0xd0
+	 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 8, 8, 6, 6,	// 0xe0
+	 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 9, 9, 7, 7	// 0xf0
+};
+
+static constexpr Byte	mc6809_cycles11[256] = {
+//	 0  1  2  3  4  5  6  7  8  9  a  b  c  d  e  f
+	 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,	// 0x00
+	 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,	// 0x10
+	 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,	// 0x20
+	 7, 7, 7, 7, 7, 7, 7, 8, 6, 6, 6, 6, 4, 5, 0,20,	// 0x30
+	 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 3, 0, 3, 3, 0, 3,	// 0x40
+	 0, 0, 0, 3, 0, 0, 0, 0, 0, 0, 3, 0, 3, 3, 0, 3,	// 0x50
+	 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,	// 0x60
+	 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,	// 0x70
+	 3, 3, 0, 5, 0, 0, 3, 0, 0, 0, 0, 3, 5,25,36,28,	// 0x80
+	 5, 5, 0, 7, 0, 0, 5, 5, 0, 0, 0, 5, 7,27,38,30,	// 0x90
+	 5, 5, 0, 7, 0, 0, 5, 5, 0, 0, 0, 5, 7,27,38,30,	// 0xa0
+	 6, 6, 0, 8, 0, 0, 6, 6, 0, 0, 0, 6, 8,28,39,31,	// 0xb0
+	 3, 3, 0, 0, 0, 0, 3, 0, 0, 0, 0, 3, 0, 0, 0, 0,	// 0xc0
+	 5, 5, 0, 0, 0, 0, 5, 5, 0, 0, 0, 5, 0, 0, 0, 0,	// 0xd0
+	 5, 5, 0, 0, 0, 0, 5, 5, 0, 0, 0, 5, 0, 0, 0, 0,	// 0xe0
+	 6, 6, 0, 0, 0, 0, 6, 6, 0, 0, 0, 6, 0, 0, 0, 0	// 0xf0
+};
+
+//----------------------------------------------------------------------------
+// The table, built from the definitions above at compile time
+//----------------------------------------------------------------------------
+
+// Bytes following the opcode, by mc6809_operand
+static constexpr Byte	mc6809_operand_len[opd_count] = {
+	0, 1, 2, 4, 1, 2, 1, 1, 2, 1, 1, 1, 2, 2, 3, 2, 1
+};
+
+constexpr Byte mc6809_operand_mode(Byte operand)
+{
+	switch (operand) {
+		case opd_none:
+			return mode_inherent;
+		case opd_direct: case opd_imm_direct: case opd_bit:
+			return mode_direct;
+		case opd_indexed: case opd_imm_indexed:
+			return mode_indexed;
+		case opd_extended: case opd_imm_extended:
+			return mode_extended;
+	}
+	return mode_immediate;
+}
+
+struct mc6809_optable {
+	mc6809_opinfo		op[2][3][256];	// By is6309, page and opcode
+};
+
+constexpr int mc6809_page(Word code)
+{
+	return ((code >> 8) == 0x10) ? 1 : ((code >> 8) == 0x11) ? 2 : 0;
+}
+
+constexpr void mc6809_define(mc6809_optable& t, int c, Word code,
+	const mc6809_opdef& def, Byte operand)
+{
+	mc6809_opinfo&	info = t.op[c][mc6809_page(code)][code & 0xff];
+
+	info.mnemonic = def.mnemonic;
+	info.mode = mc6809_operand_mode(operand);
+	info.operand = operand;
+	info.len = (code > 0xff ? 2 : 1) + mc6809_operand_len[operand];
+	info.ccread = def.ccread;
+	info.ccwrite = def.ccwrite;
+}
+
+constexpr mc6809_optable mc6809_build_optable(void)
+{
+	mc6809_optable	t = {};
+
+	for (int c = 0; c < 2; c++) {
+		for (int p = 0; p < 3; p++) {
+			for (int i = 0; i < 256; i++) {
+				mc6809_opinfo&	info = t.op[c][p][i];
+
+				info.mnemonic = mn_illegal;
+				info.page = (p == 0) ? 0 : 0x0f + p;
+				info.mode = mode_inherent;
+				info.operand = opd_none;
+				info.len = (p == 0) ? 1 : 2;
+				info.cycles = (p == 0) ? mc6809_cycles0[c][i] :
+					(p == 1) ? mc6809_cycles10[i] : mc6809_cycles11[i];
+			}
+		}
+	}
+
+	for (const mc6809_opdef& def : mc6809_opdefs) {
+		for (int c = 0; c < 2; c++) {
+			if (!(def.cpu & (1 << c))) {
+				continue;
+			}
+			bool	imm = (def.operand == opd_imm8);
+
+			switch (def.form) {
+				case form_one:
+					mc6809_define(t, c, def.code, def, def.operand);
+					break;
+				case form_alu:
+					mc6809_define(t, c, def.code, def, def.operand);
+					// fall through
+				case form_mem:
+					mc6809_define(t, c, def.code + 0x10, def, opd_direct);
+					mc6809_define(t, c, def.code + 0x20, def, opd_indexed);
+					mc6809_define(t, c, def.code + 0x30, def, opd_extended);
+					break;
+				case form_rmw:
+					mc6809_define(t, c, def.code, def, imm ? opd_imm_direct : opd_direct);
+					mc6809_define(t, c, def.code + 0x60, def, imm ? opd_imm_indexed : opd_indexed);
+					mc6809_define(t, c, def.code + 0x70, def, imm ? opd_imm_extended : opd_extended);
+					break;
+			}
+		}
+	}
+
+	return t;
+}
+
+static constexpr mc6809_optable	mc6809_optable_data = mc6809_build_optable();
+
+// Metadata of an opcode, with any 0x10 or 0x11 prefix in the high byte
+constexpr const mc6809_opinfo& mc6809_opcode(int is6309, Word ir)
+{
+	return mc6809_optable_data.op[is6309 ? 1 : 0][mc6809_page(ir)][ir & 0xff];
+}
+
+// Bytes that follow an indexed postbyte
+constexpr int mc6809_index_len(int is6309, Byte post)
+{
+	if (!(post & 0x80)) {
+		return 0;
+	}
+	if (is6309 && ((post & 0x9f) == 0x8f || (post & 0x9f) == 0x90)) {
+		return ((post & 0x60) == 0x20) ? 2 : 0;
+	}
+	switch (post & 0x1f) {
+		case 0x08: case 0x0c: case 0x18: case 0x1c:
+			return 1;
+		case 0x09: case 0x0d: case 0x19: case 0x1d: case 0x1f:
+			return 2;
+	}
+	return 0;
+}
+
+static_assert(mc6809_opcode(0, 0x01).mnemonic == mn_neg, "undocumented NEG on the MC6809");
+static_assert(mc6809_opcode(1, 0x01).mnemonic == mn_oim, "OIM on the HD6309");
+static_assert(mc6809_opcode(1, 0xcd).len == 5, "LDQ immediate is five bytes");
+static_assert(mc6809_opcode(1, 0x11ad).mode == mode_indexed, "DIVD indexed");
+static_assert(mc6809_opcode(0, 0x10dc).mnemonic == mn_illegal, "LDQ is HD6309 only");
+
+#endif // __mc6809op_h__
@@ -16,7 +16,7 @@
 //----------------------------------------------------------------------------
 void USim::run(void)
 {
-	halted = 0;
+	halted = false;
 	while (!halted) {
 		execute();
 	}
@@ -31,7 +31,7 @@ void USim::step(void)
 
 void USim::halt(void)
 {
-	halted = 1;
+	halted.store(true, std::memory_order_relaxed);
 }
 
 Byte USim::fetch(void)
@@ -134,6 +134,8 @@ void USim::load_intelhex(const char *filename)
 		(void)fread_byte(fp);
 		if (fgetc(fp) == '\r') (void)fgetc(fp);
 	}
+
+	fclose(fp);
 }
 
 //----------------------------------------------------------------------------
@@ -9,6 +9,8 @@
 #ifndef __usim_h__
 #define __usim_h__
 
+#include <atomic>
+
 #include "machdep.h"
 #include "typedefs.h"
 #include "misc.h"
@@ -18,7 +20,7 @@ class USim {
 // Generic processor state
 protected:
 
-		int		 halted;
+		std::atomic<bool> halted;	// set by halt(), from any thread
 		Byte		*memory;
 		Byte		*port;
 
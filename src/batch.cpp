@@ -0,0 +1,300 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    Headless batch runner: runs many independent machines
+    on a pool of worker threads.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <thread>
+#include "batch.h"
+
+static std::string trim(const std::string &s)
+{
+    size_t first = s.find_first_not_of(" \t\r\n");
+    if (first == std::string::npos)
+    {
+        return std::string();
+    }
+    size_t last = s.find_last_not_of(" \t\r\n");
+    return s.substr(first, last - first + 1);
+}
+
+static std::string unescape(const std::string &s)
+{
+    std::string out;
+    for(size_t i=0; i<s.size(); i++)
+    {
+        if ((s[i] != '\\') || (i+1 >= s.size()))
+        {
+            out += s[i];
+            continue;
+        }
+
+        i++;
+        switch(s[i])
+        {
+        case 'r':
+            out += '\r';
+            break;
+        case 'n':
+            out += '\n';
+            break;
+        case 't':
+            out += '\t';
+            break;
+        case 'x':
+            out += static_cast<char>(strtol(s.substr(i+1, 2).c_str(), NULL, 16));
+            i += 2;
+            break;
+        default:
+            out += s[i];
+            break;
+        }
+    }
+    return out;
+}
+
+bool loadManifest(const std::string &filename, std::vector<BatchJob> &jobs)
+{
+    FILE *fin = fopen(filename.c_str(), "rt");
+    if (fin == 0)
+    {
+        printf("Cannot open manifest %s\n", filename.c_str());
+        return false;
+    }
+
+    char buffer[4096];
+    uint32_t lineNum = 0;
+    bool ok = true;
+    while(ok && (fgets(buffer, sizeof(buffer), fin) != nullptr))
+    {
+        lineNum++;
+        std::string line = trim(buffer);
+        if (line.empty() || (line[0] == '#'))
+        {
+            continue;
+        }
+
+        if (line[0] == '[')
+        {
+            if (line.back() != ']')
+            {
+                ok = false;
+                break;
+            }
+            jobs.emplace_back();
+            jobs.back().name = trim(line.substr(1, line.size() - 2));
+            continue;
+        }
+
+        size_t eq = line.find('=');
+        if ((eq == std::string::npos) || jobs.empty())
+        {
+            ok = false;
+            break;
+        }
+
+        std::string key = trim(line.substr(0, eq));
+        std::string value = trim(line.substr(eq + 1));
+        BatchJob &job = jobs.back();
+        if (key == "hex")
+        {
+            job.hex.push_back(value);
+        }
+        else if (key == "disk")
+        {
+            job.disks.push_back(value);
+        }
+        else if (key == "state")
+        {
+            job.state = value;
+        }
+        else if (key == "input")
+        {
+            job.input = unescape(value);
+        }
+        else if (key == "cycles")
+        {
+            job.cycles = strtoull(value.c_str(), NULL, 10);
+        }
+        else if (key == "mc6809")
+        {
+            job.mc6809 = (value != "0");
+        }
+        else if (key == "eager-flags")
+        {
+            job.eagerFlags = (value != "0");
+        }
+        else
+        {
+            ok = false;
+        }
+    }
+    fclose(fin);
+
+    if (!ok)
+    {
+        printf("%s:%u: syntax error\n", filename.c_str(), lineNum);
+    }
+    return ok;
+}
+
+const char* stopReasonName(Machine::StopReason reason)
+{
+    switch(reason)
+    {
+    case Machine::STOP_HALT:
+        return "halt";
+    case Machine::STOP_INVALID:
+        return "invalid";
+    case Machine::STOP_BUDGET:
+        return "budget";
+    case Machine::STOP_INPUT:
+        return "input";
+    case Machine::STOP_BREAK:
+        return "break";
+    case Machine::STOP_REPLAY:
+        return "replay";
+    case Machine::STOP_DIVERGED:
+        return "diverged";
+    default:
+        return "none";
+    }
+}
+
+BatchRunner::BatchRunner(const std::vector<BatchJob> &jobs) : m_jobs(jobs)
+{
+    m_results.resize(jobs.size());
+}
+
+void BatchRunner::run(uint32_t threads)
+{
+    if (threads == 0)
+    {
+        threads = 1;
+    }
+
+    // deal the jobs out round robin
+    m_workers.clear();
+    for(uint32_t i=0; i<threads; i++)
+    {
+        m_workers.emplace_back(new Worker());
+    }
+    for(size_t job=0; job<m_jobs.size(); job++)
+    {
+        m_workers[job % threads]->queue.push_back(job);
+    }
+
+    std::vector<std::thread> pool;
+    for(uint32_t i=0; i<threads; i++)
+    {
+        pool.emplace_back(&BatchRunner::work, this, i);
+    }
+    for(auto &t : pool)
+    {
+        t.join();
+    }
+}
+
+void BatchRunner::work(uint32_t self)
+{
+    size_t job;
+    while(take(self, job))
+    {
+        runJob(m_jobs[job], m_results[job]);
+    }
+}
+
+bool BatchRunner::take(uint32_t self, size_t &job)
+{
+    {
+        Worker &own = *m_workers[self];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.queue.empty())
+        {
+            job = own.queue.back();
+            own.queue.pop_back();
+            return true;
+        }
+    }
+
+    // jobs are never added, so one pass over the
+    // other queues finds any work that is left
+    for(size_t i=1; i<m_workers.size(); i++)
+    {
+        Worker &victim = *m_workers[(self + i) % m_workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.queue.empty())
+        {
+            job = victim.queue.front();
+            victim.queue.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void BatchRunner::collect(void *ctx, uint8_t c)
+{
+    static_cast<std::string*>(ctx)->push_back(static_cast<char>(c));
+}
+
+void BatchRunner::runJob(const BatchJob &job, BatchResult &result)
+{
+    Machine machine;
+    machine.setConsole(collect, &result.output);
+
+    if (!job.state.empty())
+    {
+        if (!machine.loadState(job.state))
+        {
+            result.error = "cannot load state " + job.state;
+            return;
+        }
+    }
+    else
+    {
+        for(auto &hexfile : job.hex)
+        {
+            if (!machine.loadHex(hexfile))
+            {
+                result.error = "cannot load " + hexfile;
+                return;
+            }
+        }
+    }
+
+    uint8_t drive = 0;
+    for(auto &dskfile : job.disks)
+    {
+        if (!machine.mountDisk(drive++, dskfile))
+        {
+            result.error = "cannot mount " + dskfile;
+            return;
+        }
+    }
+
+    machine.lazy_flags(!job.eagerFlags);
+    if (job.state.empty())
+    {
+        machine.hd6309(!job.mc6809);
+        machine.reset();
+    }
+
+    machine.script(job.input);
+    machine.setBudget(job.cycles);
+
+    uint64_t start = machine.get_cycles();
+    machine.run();
+    result.cycles = machine.get_cycles() - start;
+    result.reason = machine.stopReason();
+}
@@ -0,0 +1,115 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    Headless batch runner: runs many independent machines
+    on a pool of worker threads.
+
+*/
+
+#ifndef batch_h
+#define batch_h
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <memory>
+
+#include "machine.h"
+
+/** one simulation run of a batch */
+struct BatchJob
+{
+    std::string name;
+    std::vector<std::string> hex;   ///< hex files to load
+    std::vector<std::string> disks; ///< DSK images for drive 0, 1, ..
+    std::string state;              ///< snapshot to start from instead of the hex files
+    std::string input;              ///< characters typed at the guest's prompts
+    uint64_t    cycles = 0;         ///< cycle budget, 0 for none
+    bool        mc6809 = false;
+    bool        eagerFlags = false; ///< evaluate condition codes after every instruction
+};
+
+/** outcome of a BatchJob */
+struct BatchResult
+{
+    std::string error;              ///< why the job could not start, empty if it ran
+    Machine::StopReason reason = Machine::STOP_NONE;
+    std::string output;             ///< everything the guest sent to the UART
+    uint64_t    cycles = 0;         ///< cycles run by the job
+};
+
+/** read jobs from a manifest file:
+
+        # comment
+        [name]
+        hex    = boot.hex
+        disk   = flex.dsk
+        state  = flex.state
+        input  = dir\r
+        cycles = 100000000
+        mc6809 = 0
+        eager-flags = 0
+
+    hex and disk may be given more than once. The input accepts
+    the escapes \r \n \t \\ and \xHH. On error, a message is
+    printed and false is returned.
+*/
+bool loadManifest(const std::string &filename, std::vector<BatchJob> &jobs);
+
+/** printable name of a stop reason */
+const char* stopReasonName(Machine::StopReason reason);
+
+/** runs jobs on a work-stealing thread pool.
+
+    Every worker has its own queue of jobs. It takes work from
+    the back of its own queue and, once that is empty, steals
+    from the front of the others, so long jobs don't leave
+    threads idle while short ones are queued elsewhere.
+*/
+class BatchRunner
+{
+public:
+    BatchRunner(const std::vector<BatchJob> &jobs);
+
+    /** run all jobs on the given number of threads */
+    void run(uint32_t threads);
+
+    /** results in the order of the jobs */
+    const std::vector<BatchResult>& results() const
+    {
+        return m_results;
+    }
+
+protected:
+    struct Worker
+    {
+        std::mutex          mutex;
+        std::deque<size_t>  queue;  ///< indices into m_jobs
+    };
+
+    /** worker thread main loop */
+    void work(uint32_t self);
+
+    /** get the next job for a worker, false if all are taken */
+    bool take(uint32_t self, size_t &job);
+
+    /** run one job to completion */
+    void runJob(const BatchJob &job, BatchResult &result);
+
+    /** UART output handler, appends to a std::string */
+    static void collect(void *ctx, uint8_t c);
+
+    const std::vector<BatchJob> &m_jobs;
+    std::vector<BatchResult> m_results;
+    std::vector<std::unique_ptr<Worker> > m_workers;
+};
+
+#endif
@@ -0,0 +1,421 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    Benchmark suite: micro-benchmarks of instruction classes
+    and complete guest workloads, reported as instructions
+    per second, ns per instruction and cycles per second.
+
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <iostream>
+
+#include "cxxopts.hpp"
+
+#include "simulator.h"
+#include "mc6809.h"
+#include "mc6809.tcc"
+#include "mc6809in.tcc"
+
+#ifndef HD6309_SOURCE_DIR
+#define HD6309_SOURCE_DIR "."
+#endif
+
+/** the system of the original usim simulator: 64k of RAM with
+    an MC6850 ACIA at 0xC000, as used by contrib/usim/bin. The
+    console input is a fixed string, output is counted only. */
+class UsimSystem : public mc6809_core<UsimSystem>
+{
+    friend class mc6809_core<UsimSystem>;
+    typedef mc6809_core<UsimSystem> CPU;
+
+public:
+    UsimSystem(const std::string &input) : m_input(input)
+    {
+        m_inputPos = 0;
+        m_output = 0;
+        m_instructions = 0;
+        m_start = 0;
+    }
+
+    /** load an Intel hex file, its start address becomes
+        the address that restart() jumps to */
+    void load(const std::string &filename)
+    {
+        load_intelhex(filename.c_str());
+        m_start = pc;
+    }
+
+    /** reset the CPU and go to the start address */
+    void restart()
+    {
+        reset();
+        pc = m_start;
+    }
+
+    /** run for at most budget cycles or until the CPU
+        waits in SYNC or CWAI with nothing pending */
+    void run(uint64_t budget)
+    {
+        uint64_t end = cycles + budget;
+        halted = false;
+        while (!halted && !idle() && (cycles < end))
+        {
+            execute();
+            m_instructions++;
+        }
+    }
+
+    uint64_t instructions() const
+    {
+        return m_instructions;
+    }
+
+    uint64_t output() const
+    {
+        return m_output;
+    }
+
+protected:
+    static constexpr Word ACIA = 0xC000;
+    static constexpr Byte RDRF = 0x01;  ///< receive data register full
+    static constexpr Byte TDRE = 0x02;  ///< transmit data register empty
+
+    Byte bus_read(Word address)
+    {
+        if ((address & 0xFFFE) != ACIA)
+        {
+            return memory[address];
+        }
+        if (address == ACIA)
+        {
+            return TDRE | ((m_inputPos < m_input.size()) ? RDRF : 0);
+        }
+        return (m_inputPos < m_input.size()) ? m_input[m_inputPos++] : 0;
+    }
+
+    void bus_write(Word address, Byte value)
+    {
+        if ((address & 0xFFFE) != ACIA)
+        {
+            memory[address] = value;
+        }
+        else if (address == ACIA + 1)
+        {
+            m_output++;
+        }
+    }
+
+    Byte* bus_span(Word address, Word len, int /*write*/)
+    {
+        uint32_t end = static_cast<uint32_t>(address) + len;
+        if ((end > 0x10000) || ((address <= ACIA + 1) && (end > ACIA)))
+        {
+            return nullptr;
+        }
+        return memory + address;
+    }
+
+    virtual Byte read(Word address) override
+    {
+        return bus_read(address);
+    }
+
+    virtual void write(Word address, Byte value) override
+    {
+        bus_write(address, value);
+    }
+
+    std::string m_input;
+    size_t   m_inputPos;
+    uint64_t m_output;          ///< characters sent to the ACIA
+    uint64_t m_instructions;
+    Word     m_start;
+};
+
+template class mc6809_core<UsimSystem>;
+
+/** outcome of one benchmark */
+struct Result
+{
+    std::string name;
+    std::string kind;           ///< "micro" or "macro"
+    std::string mode;           ///< how the machine executes code
+    uint64_t instructions;
+    uint64_t cycles;
+    double   seconds;
+};
+
+/** a micro-benchmark: an endless loop at 0x1000 */
+struct Micro
+{
+    const char *name;
+    std::vector<uint8_t> code;
+};
+
+static const std::vector<Micro> g_micros =
+{
+    {"alu", {
+        0x86, 0x01,                 // 1000 LDA  #1
+        0x8B, 0x03,                 // 1002 ADDA #3
+        0xC6, 0x05,                 // 1004 LDB  #5
+        0xC0, 0x02,                 // 1006 SUBB #2
+        0x84, 0x7F,                 // 1008 ANDA #$7F
+        0x8A, 0x10,                 // 100A ORA  #$10
+        0x88, 0x55,                 // 100C EORA #$55
+        0x4C,                       // 100E INCA
+        0x5A,                       // 100F DECB
+        0x20, 0xEE                  // 1010 BRA  $1000
+    }},
+    {"indexed", {
+        0x8E, 0x20, 0x00,           // 1000 LDX  #$2000
+        0xA6, 0x84,                 // 1003 LDA  ,X
+        0xA7, 0x01,                 // 1005 STA  1,X
+        0xE6, 0x88, 0x10,           // 1007 LDB  16,X
+        0xE7, 0x80,                 // 100A STB  ,X+
+        0xA6, 0x85,                 // 100C LDA  B,X
+        0xEC, 0x81,                 // 100E LDD  ,X++
+        0x30, 0x1F,                 // 1010 LEAX -1,X
+        0x20, 0xEC                  // 1012 BRA  $1000
+    }},
+    {"pshpul", {
+        0x10, 0xCE, 0x30, 0x00,     // 1000 LDS  #$3000
+        0xCE, 0x38, 0x00,           // 1004 LDU  #$3800
+        0x34, 0x76,                 // 1007 PSHS A,B,X,Y,U
+        0x35, 0x76,                 // 1009 PULS A,B,X,Y,U
+        0x36, 0x16,                 // 100B PSHU A,B,X
+        0x37, 0x16,                 // 100D PULU A,B,X
+        0x34, 0x06,                 // 100F PSHS A,B
+        0x35, 0x06,                 // 1011 PULS A,B
+        0x20, 0xF2                  // 1013 BRA  $1007
+    }},
+    {"branch", {
+        0x10, 0xCE, 0x30, 0x00,     // 1000 LDS  #$3000
+        0x8E, 0x00, 0x00,           // 1004 LDX  #0
+        0x30, 0x01,                 // 1007 LEAX 1,X
+        0x8C, 0x00, 0x10,           // 1009 CMPX #$0010
+        0x26, 0xF9,                 // 100C BNE  $1007
+        0x8D, 0x02,                 // 100E BSR  $1012
+        0x20, 0xF2,                 // 1010 BRA  $1004
+        0x39                        // 1012 RTS
+    }}
+};
+
+/** typed into Tiny BASIC, loops forever */
+static const char g_basicProgram[] =
+    "10 I=0\r"
+    "20 S=0\r"
+    "30 I=I+1\r"
+    "40 S=I*7/3-I+S/2\r"
+    "50 IF I<1000 GOTO 30\r"
+    "60 PRINT S\r"
+    "70 GOTO 10\r"
+    "RUN\r";
+
+typedef std::chrono::steady_clock Clock;
+
+static double since(Clock::time_point start)
+{
+    return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+static Result runMicro(const Micro &micro, double minSeconds)
+{
+    static const uint8_t resetVector[] = {0x10, 0x00};
+    const uint64_t chunk = 10000000;
+
+    Simulator sim;
+    sim.load(0x1000, micro.code.data(), micro.code.size());
+    sim.load(0xFFFE, resetVector, sizeof(resetVector));
+    sim.reset();
+
+    auto start = Clock::now();
+    do
+    {
+        sim.run(chunk);
+    } while (since(start) < minSeconds);
+
+    return {micro.name, "micro", "cached",
+        sim.instructions(), sim.cycles(), since(start)};
+}
+
+/** boot the HD6309 computer to its prompt, repeatedly,
+    each run on a fork of the freshly reset machine */
+static Result runBoot(const std::string &dataDir, double minSeconds)
+{
+    Simulator base;
+    if (!base.loadHex(dataDir + "/example/boot.hex"))
+    {
+        return {"boot", "macro", "missing", 0, 0, 0.0};
+    }
+    base.reset();
+
+    Result result = {"boot", "macro", "cached", 0, 0, 0.0};
+    auto start = Clock::now();
+    do
+    {
+        Simulator *sim = base.fork();
+        uint64_t cycles = sim->cycles();
+        sim->run();
+        result.instructions += sim->instructions();
+        result.cycles += sim->cycles() - cycles;
+        delete sim;
+    } while (since(start) < minSeconds);
+    result.seconds = since(start);
+    return result;
+}
+
+/** run a usim program, restarting it whenever it stops */
+static Result runUsim(const std::string &name, const std::string &hexfile,
+    const std::string &input, double minSeconds)
+{
+    const uint64_t chunk = 10000000;
+
+    FILE *f = fopen(hexfile.c_str(), "r");
+    if (f == 0)
+    {
+        return {name, "macro", "missing", 0, 0, 0.0};
+    }
+    fclose(f);
+
+    Result result = {name, "macro", "core", 0, 0, 0.0};
+    auto start = Clock::now();
+    do
+    {
+        UsimSystem sys(input);
+        sys.load(hexfile);
+        sys.restart();
+        while (since(start) < minSeconds)
+        {
+            sys.run(chunk);
+            if (sys.idle())
+            {
+                break;
+            }
+        }
+        result.instructions += sys.instructions();
+        result.cycles += sys.get_cycles();
+    } while (since(start) < minSeconds);
+    result.seconds = since(start);
+    return result;
+}
+
+static void printTable(const std::vector<Result> &results)
+{
+    printf("%-10s %-6s %-8s %14s %14s %8s %8s %9s\n", "name", "kind", "mode",
+        "instructions", "cycles", "MIPS", "ns/insn", "MHz");
+    for(auto &r : results)
+    {
+        double ips = (r.seconds > 0.0) ? r.instructions / r.seconds : 0.0;
+        double cps = (r.seconds > 0.0) ? r.cycles / r.seconds : 0.0;
+        double ns  = (r.instructions > 0) ? r.seconds * 1e9 / r.instructions : 0.0;
+        printf("%-10s %-6s %-8s %14llu %14llu %8.2f %8.2f %9.2f\n",
+            r.name.c_str(), r.kind.c_str(), r.mode.c_str(),
+            static_cast<unsigned long long>(r.instructions),
+            static_cast<unsigned long long>(r.cycles),
+            ips / 1e6, ns, cps / 1e6);
+    }
+}
+
+/** one object per line, keys in a fixed order */
+static void printJson(const std::vector<Result> &results)
+{
+    printf("{\n  \"version\": 1,\n  \"benchmarks\": [\n");
+    for(size_t i=0; i<results.size(); i++)
+    {
+        const Result &r = results[i];
+        double ips = (r.seconds > 0.0) ? r.instructions / r.seconds : 0.0;
+        double cps = (r.seconds > 0.0) ? r.cycles / r.seconds : 0.0;
+        double ns  = (r.instructions > 0) ? r.seconds * 1e9 / r.instructions : 0.0;
+        printf("    {\"name\": \"%s\", \"kind\": \"%s\", \"mode\": \"%s\", "
+            "\"instructions\": %llu, \"cycles\": %llu, \"seconds\": %.6f, "
+            "\"instructions_per_second\": %.0f, \"ns_per_instruction\": %.3f, "
+            "\"cycles_per_second\": %.0f}%s\n",
+            r.name.c_str(), r.kind.c_str(), r.mode.c_str(),
+            static_cast<unsigned long long>(r.instructions),
+            static_cast<unsigned long long>(r.cycles),
+            r.seconds, ips, ns, cps, (i+1 < results.size()) ? "," : "");
+    }
+    printf("  ]\n}\n");
+}
+
+int main(int argc, char *argv[])
+{
+    cxxopts::Options options("hd6309bench", "Benchmarks of the HD6309 simulator");
+
+    bool json = false;
+    double seconds = 0.5;
+    std::string dataDir = HD6309_SOURCE_DIR;
+    std::string filter;
+
+    options.add_options()
+        ("json", "Print the results as JSON", cxxopts::value<bool>(json))
+        ("seconds", "Minimum run time of each benchmark", cxxopts::value<double>(seconds))
+        ("data", "Source tree with example/ and contrib/usim/bin/", cxxopts::value<std::string>(dataDir))
+        ("filter", "Only run benchmarks whose name contains this", cxxopts::value<std::string>(filter))
+        ("help", "Print help")
+    ;
+
+    try
+    {
+        auto result = options.parse(argc, argv);
+        if (result.count("help"))
+        {
+            std::cout << options.help({""}) << std::endl;
+            return 0;
+        }
+    }
+    catch(...)
+    {
+        return -1;
+    }
+
+    auto selected = [&filter](const std::string &name)
+    {
+        return filter.empty() || (name.find(filter) != std::string::npos);
+    };
+
+    std::vector<Result> results;
+    for(auto &micro : g_micros)
+    {
+        if (selected(micro.name))
+        {
+            results.push_back(runMicro(micro, seconds));
+        }
+    }
+
+    if (selected("boot"))
+    {
+        results.push_back(runBoot(dataDir, seconds));
+    }
+    if (selected("tbasic"))
+    {
+        results.push_back(runUsim("tbasic", dataDir + "/contrib/usim/bin/tbasic.hex",
+            g_basicProgram, seconds));
+    }
+    if (selected("monitor"))
+    {
+        results.push_back(runUsim("monitor", dataDir + "/contrib/usim/bin/monitor.hex",
+            "", seconds));
+    }
+
+    if (json)
+    {
+        printJson(results);
+    }
+    else
+    {
+        printTable(results);
+    }
+    return 0;
+}
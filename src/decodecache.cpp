@@ -0,0 +1,53 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+    
+    www.moseleyinstruments.com
+    
+    namoseley.wordpress.com
+
+    Cache of pre-decoded instructions, indexed by
+    physical address.
+
+*/
+
+#include "decodecache.h"
+
+DecodeCache::DecodeCache(uint32_t size)
+{
+    m_pages.resize((size + 255) >> 8, nullptr);
+}
+
+DecodeCache::~DecodeCache()
+{
+    for(auto page : m_pages)
+    {
+        delete[] page;
+    }
+}
+
+mc6809_decoded* DecodeCache::allocPage(uint32_t page)
+{
+    mc6809_decoded *entries = new mc6809_decoded[256];
+    for(uint32_t i=0; i<256; i++)
+    {
+        entries[i].len = 0;
+    }
+    m_pages[page] = entries;
+    return entries;
+}
+
+void DecodeCache::flush()
+{
+    for(auto page : m_pages)
+    {
+        if (page != nullptr)
+        {
+            for(uint32_t i=0; i<256; i++)
+            {
+                page[i].len = 0;
+            }
+        }
+    }
+}
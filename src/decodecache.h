@@ -0,0 +1,95 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+    
+    www.moseleyinstruments.com
+    
+    namoseley.wordpress.com
+
+    Cache of pre-decoded instructions, indexed by
+    physical address.
+
+*/
+
+#ifndef decodecache_h
+#define decodecache_h
+
+#include <stdint.h>
+#include <vector>
+
+#include "mc6809.h"
+
+/** pre-decoded instruction cache.
+    
+    Entries are allocated lazily in pages of 256 so only
+    memory that actually holds code costs anything. 
+*/
+class DecodeCache
+{
+public:
+    /** create a cache covering physical addresses 0 .. size-1 */
+    DecodeCache(uint32_t size);
+    ~DecodeCache();
+
+    /** return the entry for a physical address, 
+        an entry with len == 0 is empty */
+    mc6809_decoded& entry(uint32_t phys)
+    {
+        mc6809_decoded *page = m_pages[phys >> 8];
+        if (page == nullptr)
+        {
+            page = allocPage(phys >> 8);
+        }
+        return page[phys & 0xFF];
+    }
+
+    /** invalidate every entry whose instruction 
+        covers the byte at the given physical address */
+    void invalidate(uint32_t phys)
+    {
+        for(uint32_t i=0; i<mc6809_decoded::max_len; i++)
+        {
+            mc6809_decoded *page = m_pages[phys >> 8];
+            if (page != nullptr)
+            {
+                page[phys & 0xFF].len = 0;
+            }
+
+            if (phys == 0) 
+            {
+                break;
+            }
+            phys--;
+        }
+    }
+
+    /** invalidate every entry whose instruction covers
+        a byte in phys .. phys+len-1 */
+    void invalidate(uint32_t phys, uint32_t len)
+    {
+        uint32_t addr = (phys < mc6809_decoded::max_len) ? 0 : phys - (mc6809_decoded::max_len - 1);
+        uint32_t end = phys + len;
+        while(addr < end)
+        {
+            mc6809_decoded *page = m_pages[addr >> 8];
+            if (page == nullptr)
+            {
+                addr = (addr | 0xFF) + 1;
+                continue;
+            }
+            page[addr & 0xFF].len = 0;
+            addr++;
+        }
+    }
+
+    /** invalidate all entries */
+    void flush();
+
+protected:
+    mc6809_decoded* allocPage(uint32_t page);
+
+    std::vector<mc6809_decoded*> m_pages;
+};
+
+#endif
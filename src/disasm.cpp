@@ -0,0 +1,272 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    MC6809 / HD6309 disassembler, driven by the opcode
+    metadata in mc6809op.h.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "mc6809op.h"
+#include "disasm.h"
+
+/** registers of TFR, EXG and the HD6309 register operations */
+static const char *s_regs[16] =
+{
+    "D", "X", "Y", "U", "S", "PC", "W", "V",
+    "A", "B", "CC", "DP", "0", "0", "E", "F"
+};
+
+/** base registers of indexed modes, by postbyte bits 5-6 */
+static const char *s_indexRegs[4] = {"X", "Y", "U", "S"};
+
+static uint16_t word(const uint8_t *p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+/** format an indexed operand: post points at the postbyte and
+    its offset, next is the address of the following instruction */
+static void indexed(bool is6309, uint16_t next, const uint8_t *post, char *text, size_t size)
+{
+    uint8_t pb = post[0];
+    const char *r = s_indexRegs[(pb >> 5) & 3];
+
+    if ((pb & 0x80) == 0)
+    {
+        int offset = (pb & 0x10) ? (pb & 0x1F) - 32 : (pb & 0x1F);
+        snprintf(text, size, "%d,%s", offset, r);
+        return;
+    }
+
+    bool indirect = (pb & 0x10) != 0;
+    bool valid = true;
+    char inner[24];
+    if (is6309 && (((pb & 0x9F) == 0x8F) || ((pb & 0x9F) == 0x90)))
+    {
+        // ,W n16,W ,W++ ,--W
+        static const char *wmodes[4] = {",W", "", ",W++", ",--W"};
+        if ((pb & 0x60) == 0x20)
+        {
+            snprintf(inner, sizeof(inner), "$%04X,W", word(post + 1));
+        }
+        else
+        {
+            snprintf(inner, sizeof(inner), "%s", wmodes[(pb >> 5) & 3]);
+        }
+    }
+    else
+    {
+        int8_t offset = static_cast<int8_t>(post[1]);
+        switch(pb & 0x0F)
+        {
+        case 0x00:
+            valid = !indirect;
+            snprintf(inner, sizeof(inner), ",%s+", r);
+            break;
+        case 0x01:
+            snprintf(inner, sizeof(inner), ",%s++", r);
+            break;
+        case 0x02:
+            valid = !indirect;
+            snprintf(inner, sizeof(inner), ",-%s", r);
+            break;
+        case 0x03:
+            snprintf(inner, sizeof(inner), ",--%s", r);
+            break;
+        case 0x04:
+            snprintf(inner, sizeof(inner), ",%s", r);
+            break;
+        case 0x05:
+            snprintf(inner, sizeof(inner), "B,%s", r);
+            break;
+        case 0x06:
+            snprintf(inner, sizeof(inner), "A,%s", r);
+            break;
+        case 0x07:
+            snprintf(inner, sizeof(inner), "E,%s", r);
+            break;
+        case 0x08:
+            snprintf(inner, sizeof(inner), "%s$%02X,%s", (offset < 0) ? "-" : "", abs(offset), r);
+            break;
+        case 0x09:
+            snprintf(inner, sizeof(inner), "$%04X,%s", word(post + 1), r);
+            break;
+        case 0x0A:
+            snprintf(inner, sizeof(inner), "F,%s", r);
+            break;
+        case 0x0B:
+            snprintf(inner, sizeof(inner), "D,%s", r);
+            break;
+        case 0x0C:
+            snprintf(inner, sizeof(inner), "$%04X,PCR", static_cast<uint16_t>(next + offset));
+            break;
+        case 0x0D:
+            snprintf(inner, sizeof(inner), "$%04X,PCR", static_cast<uint16_t>(next + word(post + 1)));
+            break;
+        case 0x0E:
+            snprintf(inner, sizeof(inner), "W,%s", r);
+            break;
+        default:
+            // only extended indirect
+            valid = (pb == 0x9F);
+            snprintf(inner, sizeof(inner), "$%04X", word(post + 1));
+            break;
+        }
+    }
+
+    if (!valid)
+    {
+        snprintf(text, size, "???");
+    }
+    else if (indirect)
+    {
+        snprintf(text, size, "[%s]", inner);
+    }
+    else
+    {
+        snprintf(text, size, "%s", inner);
+    }
+}
+
+/** format the register list of PSH and PUL; bit 6 is the other stack */
+static void stack(uint8_t post, bool userStack, char *text, size_t size)
+{
+    static const char *names[8] = {"CC", "A", "B", "DP", "X", "Y", "U", "PC"};
+    size_t used = 0;
+    text[0] = 0;
+    for(uint32_t bit=0; bit<8; bit++)
+    {
+        if (post & (1 << bit))
+        {
+            const char *name = ((bit == 6) && userStack) ? "S" : names[bit];
+            used += snprintf(text + used, size - used, "%s%s", (used != 0) ? "," : "", name);
+            if (used >= size)
+            {
+                return;
+            }
+        }
+    }
+}
+
+uint32_t disassemble(bool is6309, uint16_t pc, const uint8_t *bytes, uint32_t avail,
+    char *text, size_t size)
+{
+    text[0] = 0;
+    if (avail == 0)
+    {
+        return 0;
+    }
+
+    Word ir = bytes[0];
+    if ((ir == 0x10) || (ir == 0x11))
+    {
+        if (avail < 2)
+        {
+            return 0;
+        }
+        ir = static_cast<Word>((ir << 8) | bytes[1]);
+    }
+
+    const mc6809_opinfo &info = mc6809_opcode(is6309, ir);
+    const uint8_t *operand = bytes + ((ir > 0xFF) ? 2 : 1);
+    const uint8_t *post = operand + ((info.operand == opd_imm_indexed) ? 1 : 0);
+    uint32_t len = info.len;
+    if ((info.operand == opd_indexed) || (info.operand == opd_imm_indexed))
+    {
+        if (avail <= static_cast<uint32_t>(post - bytes))
+        {
+            return 0;
+        }
+        len += mc6809_index_len(is6309, *post);
+    }
+    if (avail < len)
+    {
+        return 0;
+    }
+
+    uint16_t next = static_cast<uint16_t>(pc + len);
+    char arg[48];
+    char idx[32];
+    arg[0] = 0;
+    switch(info.operand)
+    {
+    case opd_imm8:
+        snprintf(arg, sizeof(arg), "#$%02X", operand[0]);
+        break;
+    case opd_imm16:
+        snprintf(arg, sizeof(arg), "#$%04X", word(operand));
+        break;
+    case opd_imm32:
+        snprintf(arg, sizeof(arg), "#$%04X%04X", word(operand), word(operand + 2));
+        break;
+    case opd_rel8:
+        snprintf(arg, sizeof(arg), "$%04X", static_cast<uint16_t>(next + static_cast<int8_t>(operand[0])));
+        break;
+    case opd_rel16:
+        snprintf(arg, sizeof(arg), "$%04X", static_cast<uint16_t>(next + word(operand)));
+        break;
+    case opd_direct:
+        snprintf(arg, sizeof(arg), "<$%02X", operand[0]);
+        break;
+    case opd_indexed:
+        indexed(is6309, next, post, arg, sizeof(arg));
+        break;
+    case opd_extended:
+        snprintf(arg, sizeof(arg), "$%04X", word(operand));
+        break;
+    case opd_regs:
+        snprintf(arg, sizeof(arg), "%s,%s", s_regs[operand[0] >> 4], s_regs[operand[0] & 0x0F]);
+        break;
+    case opd_stack_s:
+    case opd_stack_u:
+        stack(operand[0], info.operand == opd_stack_u, arg, sizeof(arg));
+        break;
+    case opd_imm_direct:
+        snprintf(arg, sizeof(arg), "#$%02X,<$%02X", operand[0], operand[1]);
+        break;
+    case opd_imm_indexed:
+        indexed(is6309, next, post, idx, sizeof(idx));
+        snprintf(arg, sizeof(arg), "#$%02X,%s", operand[0], idx);
+        break;
+    case opd_imm_extended:
+        snprintf(arg, sizeof(arg), "#$%02X,$%04X", operand[0], word(operand + 1));
+        break;
+    case opd_bit:
+        {
+            static const char *bitRegs[4] = {"CC", "A", "B", "?"};
+            snprintf(arg, sizeof(arg), "%s,%d,%d,<$%02X", bitRegs[operand[0] >> 6],
+                (operand[0] >> 3) & 7, operand[0] & 7, operand[1]);
+        }
+        break;
+    case opd_tfm:
+        {
+            // TFM r+,r+  r-,r-  r+,r  r,r+
+            static const char *src[4] = {"+", "-", "+", ""};
+            static const char *dst[4] = {"+", "-", "", "+"};
+            uint32_t kind = ir & 3;
+            snprintf(arg, sizeof(arg), "%s%s,%s%s", s_regs[operand[0] >> 4], src[kind],
+                s_regs[operand[0] & 0x0F], dst[kind]);
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (arg[0] != 0)
+    {
+        snprintf(text, size, "%-5s %s", mc6809_names[info.mnemonic], arg);
+    }
+    else
+    {
+        snprintf(text, size, "%s", mc6809_names[info.mnemonic]);
+    }
+    return len;
+}
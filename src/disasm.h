@@ -0,0 +1,28 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    MC6809 / HD6309 disassembler, driven by the opcode
+    metadata in mc6809op.h.
+
+*/
+
+#ifndef disasm_h
+#define disasm_h
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** disassemble the instruction at address pc, whose first avail
+    bytes are in bytes, into text, e.g. "LDA $10,X". Returns the
+    length of the instruction, or 0 if it is longer than avail;
+    text is then empty. */
+uint32_t disassemble(bool is6309, uint16_t pc, const uint8_t *bytes, uint32_t avail,
+    char *text, size_t size);
+
+#endif
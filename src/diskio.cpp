@@ -56,8 +56,56 @@ struct DIR_t
 
 DiskIO::DiskIO()
 {
+    m_track = 0;
+    m_sector = 0;
+    m_drive = 0;
+    m_cmd = IDLECMD;
+    m_stat = 0;
+    m_byteIdx = 0;
+
     // allocate the number of drives
-    m_drives.resize(4);
+    for(uint8_t drive=0; drive<DRIVES; drive++)
+    {
+        m_drives.push_back(std::make_shared<Image>());
+    }
+}
+
+DiskIO::Image& DiskIO::writable(uint8_t drive)
+{
+    if (m_drives[drive].use_count() > 1)
+    {
+        m_drives[drive] = std::make_shared<Image>(*m_drives[drive]);
+    }
+    return *m_drives[drive];
+}
+
+void DiskIO::setImage(uint8_t drive, const uint8_t *data, size_t bytes)
+{
+    if (drive < m_drives.size())
+    {
+        m_drives[drive] = std::make_shared<Image>(data, data + bytes);
+    }
+}
+
+void DiskIO::getState(State &state) const
+{
+    state = {};
+    state.track   = m_track;
+    state.sector  = m_sector;
+    state.drive   = m_drive;
+    state.cmd     = m_cmd;
+    state.stat    = m_stat;
+    state.byteIdx = m_byteIdx;
+}
+
+void DiskIO::setState(const State &state)
+{
+    m_track   = state.track;
+    m_sector  = state.sector;
+    m_drive   = state.drive;
+    m_cmd     = state.cmd;
+    m_stat    = state.stat;
+    m_byteIdx = state.byteIdx;
 }
 
 bool DiskIO::loadImage(uint8_t drive, const std::string &filename)
@@ -81,8 +129,9 @@ bool DiskIO::loadImage(uint8_t drive, const std::string &filename)
             return false;
         }
 
-        m_drives[drive].resize(bytes);
-        fread(&m_drives[drive][0], 1, bytes, fin);
+        auto image = std::make_shared<Image>(bytes);
+        fread(image->data(), 1, bytes, fin);
+        m_drives[drive] = image;
         fclose(fin);
         return true;
     } 
@@ -93,14 +142,14 @@ bool DiskIO::getGeometry(uint8_t drive, uint8_t &tracks, uint8_t &sectors)
 {
     if (drive < m_drives.size())
     {
-        if (m_drives[drive].size() < 1024)
+        if (m_drives[drive]->size() < 1024)
         {
             // drive image incorrect
             return false;
         }
 
         size_t ofs = 256*2 + 16;  // SIR record
-        SIR_t *sir = (SIR_t*)&m_drives[drive][ofs];
+        const SIR_t *sir = (const SIR_t*)(m_drives[drive]->data() + ofs);
 
         tracks  = sir->endTrack + 1;
         sectors = sir->endSector;
@@ -127,7 +176,7 @@ void DiskIO::setByte(uint32_t drive,
     sector--;   // sectors start at 1
     size_t ofs = 256*(sector + sectors*track);
     
-    m_drives[drive][ofs+byteofs] = value;
+    writable(drive)[ofs+byteofs] = value;
 }
 
 uint8_t DiskIO::readReg(uint8_t reg)
@@ -152,7 +201,7 @@ uint8_t DiskIO::readReg(uint8_t reg)
             }
 
             size_t ofs = 256*((uint32_t)(m_sector-1) + sectors*(uint32_t)m_track);
-            uint8_t v = m_drives[m_drive][ofs+m_byteIdx];
+            uint8_t v = (*m_drives[m_drive])[ofs+m_byteIdx];
 #ifdef DEBUGPRINT            
             printf("DISKIO: data[%u]: %d\n", (uint32_t)m_byteIdx, (uint32_t)v);
 #endif
@@ -213,7 +262,7 @@ void DiskIO::writeReg(uint8_t reg, uint8_t value)
             }
 
             size_t ofs = 256*((m_sector-1) + sectors*m_track);
-            m_drives[m_drive][ofs+m_byteIdx++] = value;
+            writable(m_drive)[ofs+m_byteIdx++] = value;
             m_stat = 0x00;
         }
         else
@@ -17,11 +17,18 @@
 #include <stdint.h>
 #include <vector>
 #include <string>
+#include <memory>
 
-/** fake disk I/O subsystem */
+/** fake disk I/O subsystem.
+
+    Copies of a DiskIO share their disk images; an image is
+    only copied when a sector is written to it.
+*/
 class DiskIO
 {
 public:
+    typedef std::vector<uint8_t> Image;
+
     DiskIO();
 
     void writeReg(uint8_t reg, uint8_t value);
@@ -29,6 +36,32 @@ public:
 
     bool loadImage(uint8_t drive, const std::string &filename);
 
+    /** contents of a drive, empty if nothing is mounted */
+    const Image& image(uint8_t drive) const
+    {
+        return *m_drives[drive];
+    }
+
+    /** replace the contents of a drive */
+    void setImage(uint8_t drive, const uint8_t *data, size_t bytes);
+
+    /** register state for snapshots */
+    struct State
+    {
+        uint8_t track;
+        uint8_t sector;
+        uint8_t drive;
+        uint8_t cmd;
+        uint8_t stat;
+        uint8_t byteIdx;
+        uint8_t pad[2];
+    };
+
+    void getState(State &state) const;
+    void setState(const State &state);
+
+    static constexpr uint8_t DRIVES = 4;
+
 protected:
     bool getGeometry(uint8_t drive, uint8_t &tracks, uint8_t &sectors);
 
@@ -46,7 +79,11 @@ protected:
 
     uint8_t m_byteIdx;  ///< current byte index within sector
 
-    std::vector<std::vector<uint8_t> > m_drives;
+    /** image of a drive that may be written to, copied
+        first if it is shared with another DiskIO */
+    Image& writable(uint8_t drive);
+
+    std::vector<std::shared_ptr<Image> > m_drives;
 
     static constexpr uint8_t IDLECMD = 0;
     static constexpr uint8_t READSECTOR = 1;
@@ -0,0 +1,266 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    Lockstep check of the lazy condition codes: random
+    programs run on two cores, one evaluating the flags
+    lazily and one eagerly, and the registers and flags
+    are compared after every instruction.
+
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <random>
+#include <iostream>
+
+#include "cxxopts.hpp"
+
+#include "mc6809.h"
+#include "mc6809.tcc"
+#include "mc6809in.tcc"
+
+/** registers of the core */
+struct Regs
+{
+    uint64_t cycles;
+    Word pc;
+    Word u, s;
+    Word x, y;
+    Word d, w, v;
+    Byte dp;
+    Byte cc;
+    Byte md;
+    Byte waiting;
+    Byte is6309;
+};
+
+/** 64k of plain RAM, no devices */
+class FlagSystem : public mc6809_core<FlagSystem>
+{
+    friend class mc6809_core<FlagSystem>;
+    typedef mc6809_core<FlagSystem> CPU;
+
+public:
+    /** fill memory with image and start with the given
+        registers, with flags evaluated lazily or eagerly */
+    void start(const Byte *image, const Regs &regs, bool lazy)
+    {
+        memcpy(memory, image, 0x10000);
+        lazy_flags(lazy ? 1 : 0);
+        pc = regs.pc;
+        u  = regs.u;
+        s  = regs.s;
+        x  = regs.x;
+        y  = regs.y;
+        d  = regs.d;
+        w  = regs.w;
+        v  = regs.v;
+        dp = regs.dp;
+        cc.all = regs.cc;
+        md = regs.md;
+        waiting = 0;
+        hd6309(regs.is6309);
+        cycles = regs.cycles;
+        halted = false;
+    }
+
+    /** execute one instruction, returns false once the
+        program ran into an illegal instruction or waits */
+    bool next()
+    {
+        execute();
+        return !halted && !idle();
+    }
+
+    void getRegs(Regs &regs) const
+    {
+        regs.cycles = cycles;
+        regs.pc = pc;
+        regs.u  = u;
+        regs.s  = s;
+        regs.x  = x;
+        regs.y  = y;
+        regs.d  = d;
+        regs.w  = w;
+        regs.v  = v;
+        regs.dp = dp;
+        regs.cc = get_cc();
+        regs.md = md;
+        regs.waiting = waiting;
+        regs.is6309 = static_cast<Byte>(is6309);
+    }
+
+    const Byte* ram() const
+    {
+        return memory;
+    }
+
+protected:
+    Byte bus_read(Word address)
+    {
+        return memory[address];
+    }
+
+    void bus_write(Word address, Byte value)
+    {
+        memory[address] = value;
+    }
+
+    Byte* bus_span(Word address, Word len, int /*write*/)
+    {
+        if ((static_cast<uint32_t>(address) + len) > 0x10000)
+        {
+            return nullptr;
+        }
+        return memory + address;
+    }
+
+    virtual Byte read(Word address) override
+    {
+        return bus_read(address);
+    }
+
+    virtual void write(Word address, Byte value) override
+    {
+        bus_write(address, value);
+    }
+
+    /** random programs run into illegal opcodes all the time */
+    virtual void invalid(const char * /*msg*/) override
+    {
+        halt();
+    }
+};
+
+template class mc6809_core<FlagSystem>;
+
+static bool sameRegs(const Regs &a, const Regs &b)
+{
+    return (a.cycles == b.cycles) && (a.pc == b.pc) &&
+        (a.u == b.u) && (a.s == b.s) && (a.x == b.x) && (a.y == b.y) &&
+        (a.d == b.d) && (a.w == b.w) && (a.v == b.v) &&
+        (a.dp == b.dp) && (a.cc == b.cc) && (a.md == b.md) &&
+        (a.waiting == b.waiting);
+}
+
+static void printRegs(const char *name, const Regs &r)
+{
+    printf("  %-6s PC=%04X CC=%02X D=%04X W=%04X X=%04X Y=%04X U=%04X S=%04X DP=%02X MD=%02X cycles=%llu\n",
+        name, r.pc, r.cc, r.d, r.w, r.x, r.y, r.u, r.s, r.dp, r.md,
+        static_cast<unsigned long long>(r.cycles));
+}
+
+/** run one random program in both modes, returns false
+    at the first difference */
+static bool runProgram(uint32_t seed, uint32_t steps, uint64_t &executed)
+{
+    static Byte image[0x10000];
+    static FlagSystem lazy;
+    static FlagSystem eager;
+
+    std::mt19937 rng(seed);
+    for(uint32_t i=0; i<sizeof(image); i++)
+    {
+        image[i] = static_cast<Byte>(rng());
+    }
+
+    // random registers, odd seeds run HD6309 code
+    Regs regs = {};
+    regs.pc = static_cast<Word>(rng());
+    regs.u  = static_cast<Word>(rng());
+    regs.s  = static_cast<Word>(rng());
+    regs.x  = static_cast<Word>(rng());
+    regs.y  = static_cast<Word>(rng());
+    regs.d  = static_cast<Word>(rng());
+    regs.w  = static_cast<Word>(rng());
+    regs.v  = static_cast<Word>(rng());
+    regs.dp = static_cast<Byte>(rng());
+    regs.cc = static_cast<Byte>(rng());
+    regs.is6309 = seed & 1;
+    regs.md = static_cast<Byte>(regs.is6309 ? (rng() & 1) : 0);
+
+    lazy.start(image, regs, true);
+    eager.start(image, regs, false);
+
+    Regs before = regs;
+    for(uint32_t i=0; i<steps; i++)
+    {
+        bool lazyRuns = lazy.next();
+        bool eagerRuns = eager.next();
+        executed++;
+
+        Regs l, e;
+        lazy.getRegs(l);
+        eager.getRegs(e);
+        if (!sameRegs(l, e) || (lazyRuns != eagerRuns))
+        {
+            printf("seed %u differs after instruction %u\n", seed, i + 1);
+            printRegs("before", before);
+            printRegs("lazy", l);
+            printRegs("eager", e);
+            return false;
+        }
+        if (!lazyRuns)
+        {
+            break;
+        }
+        before = l;
+    }
+
+    if (memcmp(lazy.ram(), eager.ram(), sizeof(image)) != 0)
+    {
+        printf("seed %u: memory differs at the end of the program\n", seed);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    cxxopts::Options options("hd6309flags", "Lockstep check of lazy against eager condition codes");
+
+    uint32_t first = 1;
+    uint32_t count = 1000;
+    uint32_t steps = 10000;
+
+    options.add_options()
+        ("seed", "First random seed", cxxopts::value<uint32_t>(first))
+        ("programs", "Number of random programs", cxxopts::value<uint32_t>(count))
+        ("steps", "Maximum instructions per program", cxxopts::value<uint32_t>(steps))
+        ("help", "Print help")
+    ;
+
+    try
+    {
+        auto result = options.parse(argc, argv);
+        if (result.count("help"))
+        {
+            std::cout << options.help({""}) << std::endl;
+            return 0;
+        }
+    }
+    catch(...)
+    {
+        return -1;
+    }
+
+    uint64_t executed = 0;
+    for(uint32_t seed=first; seed<first + count; seed++)
+    {
+        if (!runProgram(seed, steps, executed))
+        {
+            return 1;
+        }
+    }
+
+    printf("%u programs, %llu instructions, no differences\n", count,
+        static_cast<unsigned long long>(executed));
+    return 0;
+}
@@ -0,0 +1,754 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    GDB remote serial protocol stub: lets a debugger
+    control the machine over a local socket.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "gdbstub.h"
+
+static const char g_targetXml[] =
+    "<?xml version=\"1.0\"?>"
+    "<!DOCTYPE target SYSTEM \"gdb-target.dtd\">"
+    "<target version=\"1.0\">"
+    "<feature name=\"org.gnu.gdb.m6809.core\">"
+    "<reg name=\"cc\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"a\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"b\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"dp\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"x\" bitsize=\"16\" type=\"data_ptr\"/>"
+    "<reg name=\"y\" bitsize=\"16\" type=\"data_ptr\"/>"
+    "<reg name=\"u\" bitsize=\"16\" type=\"data_ptr\"/>"
+    "<reg name=\"s\" bitsize=\"16\" type=\"data_ptr\"/>"
+    "<reg name=\"pc\" bitsize=\"16\" type=\"code_ptr\"/>"
+    "<reg name=\"e\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"f\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"v\" bitsize=\"16\" type=\"uint16\"/>"
+    "<reg name=\"md\" bitsize=\"8\" type=\"uint8\"/>"
+    "<reg name=\"d\" bitsize=\"16\" type=\"uint16\"/>"
+    "</feature>"
+    "</target>";
+
+/** register numbers of the 'g' packet */
+enum GdbRegister
+{
+    REG_CC, REG_A, REG_B, REG_DP, REG_X, REG_Y, REG_U, REG_S,
+    REG_PC, REG_E, REG_F, REG_V, REG_MD, REG_D, REG_COUNT
+};
+
+static const uint32_t g_regBytes[REG_COUNT] = {1, 1, 1, 1, 2, 2, 2, 2, 2, 1, 1, 2, 1, 2};
+
+static uint32_t getRegister(const mc6809_state &cpu, uint32_t reg)
+{
+    switch(reg)
+    {
+    case REG_CC: return cpu.cc;
+    case REG_A:  return cpu.d >> 8;
+    case REG_B:  return cpu.d & 0xFF;
+    case REG_DP: return cpu.dp;
+    case REG_X:  return cpu.x;
+    case REG_Y:  return cpu.y;
+    case REG_U:  return cpu.u;
+    case REG_S:  return cpu.s;
+    case REG_PC: return cpu.pc;
+    case REG_E:  return cpu.w >> 8;
+    case REG_F:  return cpu.w & 0xFF;
+    case REG_V:  return cpu.v;
+    case REG_MD: return cpu.md;
+    case REG_D:  return cpu.d;
+    }
+    return 0;
+}
+
+static void setRegister(mc6809_state &cpu, uint32_t reg, uint32_t value)
+{
+    switch(reg)
+    {
+    case REG_CC: cpu.cc = value; break;
+    case REG_A:  cpu.d = (cpu.d & 0x00FF) | (value << 8); break;
+    case REG_B:  cpu.d = (cpu.d & 0xFF00) | (value & 0xFF); break;
+    case REG_DP: cpu.dp = value; break;
+    case REG_X:  cpu.x = value; break;
+    case REG_Y:  cpu.y = value; break;
+    case REG_U:  cpu.u = value; break;
+    case REG_S:  cpu.s = value; break;
+    case REG_PC: cpu.pc = value; break;
+    case REG_E:  cpu.w = (cpu.w & 0x00FF) | (value << 8); break;
+    case REG_F:  cpu.w = (cpu.w & 0xFF00) | (value & 0xFF); break;
+    case REG_V:  cpu.v = value; break;
+    case REG_MD: cpu.md = value; break;
+    case REG_D:  cpu.d = value; break;
+    }
+}
+
+static int hexValue(int c)
+{
+    if ((c >= '0') && (c <= '9'))
+    {
+        return c - '0';
+    }
+    if ((c >= 'a') && (c <= 'f'))
+    {
+        return c - 'a' + 10;
+    }
+    if ((c >= 'A') && (c <= 'F'))
+    {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+/** value of the hex digits at pos, pos is moved past them */
+static uint32_t parseHex(const std::string &s, size_t &pos)
+{
+    uint32_t value = 0;
+    while((pos < s.size()) && (hexValue(s[pos]) >= 0))
+    {
+        value = (value << 4) | hexValue(s[pos++]);
+    }
+    return value;
+}
+
+/** value as bytes big endian hex digits */
+static std::string toHex(uint32_t value, uint32_t bytes)
+{
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    for(int32_t nibble=bytes*2-1; nibble>=0; nibble--)
+    {
+        hex += digits[(value >> (nibble*4)) & 0xF];
+    }
+    return hex;
+}
+
+GdbStub::GdbStub(Machine &machine) : m_machine(machine)
+{
+    m_listen = -1;
+    m_client = -1;
+    m_ack = true;
+    m_receivedPos = 0;
+    m_lastStop = "S05";
+    m_detach = false;
+    m_quit = false;
+    m_running = false;
+}
+
+GdbStub::~GdbStub()
+{
+    stopFree();
+    if (m_listen >= 0)
+    {
+        close(m_listen);
+    }
+    if (!m_unixPath.empty())
+    {
+        unlink(m_unixPath.c_str());
+    }
+}
+
+bool GdbStub::listen(const std::string &address)
+{
+    bool isPort = !address.empty() && (address.find_first_not_of("0123456789") == std::string::npos);
+    if (isPort)
+    {
+        m_listen = socket(AF_INET, SOCK_STREAM, 0);
+        if (m_listen < 0)
+        {
+            return false;
+        }
+
+        int one = 1;
+        setsockopt(m_listen, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        // the debugger has to run on this host
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(atoi(address.c_str()));
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (bind(m_listen, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        sockaddr_un addr = {};
+        if (address.size() >= sizeof(addr.sun_path))
+        {
+            return false;
+        }
+
+        m_listen = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (m_listen < 0)
+        {
+            return false;
+        }
+
+        addr.sun_family = AF_UNIX;
+        strcpy(addr.sun_path, address.c_str());
+        unlink(address.c_str());
+        if (bind(m_listen, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+        {
+            return false;
+        }
+        m_unixPath = address;
+    }
+
+    return ::listen(m_listen, 1) == 0;
+}
+
+void GdbStub::serve()
+{
+    while(!m_quit)
+    {
+        int client = accept(m_listen, nullptr, nullptr);
+        if (client < 0)
+        {
+            if ((errno == EINTR) && !m_quit)
+            {
+                continue;
+            }
+            break;
+        }
+
+        m_client = client;
+        stopFree();
+        session();
+        m_client = -1;
+        close(client);
+
+        if (m_detach && !m_quit)
+        {
+            runFree();
+        }
+    }
+    stopFree();
+}
+
+void GdbStub::stop()
+{
+    m_quit = true;
+    shutdown(m_listen, SHUT_RDWR);
+    int client = m_client;
+    if (client >= 0)
+    {
+        shutdown(client, SHUT_RDWR);
+    }
+}
+
+void GdbStub::session()
+{
+    m_ack = true;
+    m_received.clear();
+    m_receivedPos = 0;
+    m_detach = false;
+    m_lastStop = "S05";
+
+    int one = 1;
+    setsockopt(m_client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    // every hit stops the machine for the debugger
+    m_machine.setBreakHandler(nullptr, nullptr);
+
+    std::string packet;
+    while(!m_quit && getPacket(packet))
+    {
+        if (!handle(packet))
+        {
+            break;
+        }
+    }
+
+    // nobody would handle the hits anymore
+    m_machine.clearBreakpoints();
+}
+
+int GdbStub::getByte()
+{
+    if (m_receivedPos >= m_received.size())
+    {
+        char buffer[4096];
+        ssize_t bytes = recv(m_client, buffer, sizeof(buffer), 0);
+        if (bytes <= 0)
+        {
+            return -1;
+        }
+        m_received.assign(buffer, bytes);
+        m_receivedPos = 0;
+    }
+    return static_cast<uint8_t>(m_received[m_receivedPos++]);
+}
+
+bool GdbStub::getPacket(std::string &packet)
+{
+    while(true)
+    {
+        // skip acknowledgements and interrupts while stopped
+        int c;
+        do
+        {
+            c = getByte();
+            if (c < 0)
+            {
+                return false;
+            }
+        } while(c != '$');
+
+        packet.clear();
+        uint8_t sum = 0;
+        while((c = getByte()) != '#')
+        {
+            if (c < 0)
+            {
+                return false;
+            }
+            packet += static_cast<char>(c);
+            sum += c;
+        }
+
+        int high = getByte();
+        int low = getByte();
+        if ((high < 0) || (low < 0))
+        {
+            return false;
+        }
+
+        if (!m_ack)
+        {
+            return true;
+        }
+        if (((hexValue(high) << 4) | hexValue(low)) == sum)
+        {
+            send(m_client, "+", 1, MSG_NOSIGNAL);
+            return true;
+        }
+        send(m_client, "-", 1, MSG_NOSIGNAL);
+    }
+}
+
+void GdbStub::putPacket(const std::string &data)
+{
+    uint8_t sum = 0;
+    for(char c : data)
+    {
+        sum += c;
+    }
+    std::string packet = "$" + data + "#" + toHex(sum, 1);
+
+    while(true)
+    {
+        if (send(m_client, packet.data(), packet.size(), MSG_NOSIGNAL) < 0)
+        {
+            return;
+        }
+        if (!m_ack)
+        {
+            return;
+        }
+
+        int c;
+        do
+        {
+            c = getByte();
+        } while((c >= 0) && (c != '+') && (c != '-'));
+        if (c != '-')
+        {
+            return;
+        }
+    }
+}
+
+bool GdbStub::handle(const std::string &packet)
+{
+    std::string reply;
+    size_t pos = 1;
+
+    switch(packet.empty() ? 0 : packet[0])
+    {
+    case '?':
+        reply = m_lastStop;
+        break;
+    case 'g':
+        reply = readRegisters();
+        break;
+    case 'G':
+        writeRegisters(packet.substr(1));
+        reply = "OK";
+        break;
+    case 'p':
+        {
+            uint32_t reg = parseHex(packet, pos);
+            if (reg < REG_COUNT)
+            {
+                mc6809_state cpu;
+                m_machine.get_state(cpu);
+                reply = toHex(getRegister(cpu, reg), g_regBytes[reg]);
+            }
+            else
+            {
+                reply = "E01";
+            }
+        }
+        break;
+    case 'P':
+        {
+            uint32_t reg = parseHex(packet, pos);
+            pos++;
+            uint32_t value = parseHex(packet, pos);
+            reply = writeRegister(reg, value) ? "OK" : "E01";
+        }
+        break;
+    case 'm':
+        {
+            uint32_t address = parseHex(packet, pos);
+            pos++;
+            uint32_t len = parseHex(packet, pos);
+            for(uint32_t i=0; i<len; i++)
+            {
+                reply += toHex(m_machine.peek(static_cast<Word>(address + i)), 1);
+            }
+        }
+        break;
+    case 'M':
+        {
+            uint32_t address = parseHex(packet, pos);
+            pos++;
+            uint32_t len = parseHex(packet, pos);
+            pos++;
+            for(uint32_t i=0; (i<len) && (pos+1 < packet.size()); i++, pos+=2)
+            {
+                Byte value = (hexValue(packet[pos]) << 4) | hexValue(packet[pos+1]);
+                m_machine.poke(static_cast<Word>(address + i), value);
+            }
+            m_machine.restartHistory();
+            reply = "OK";
+        }
+        break;
+    case 'c':
+    case 's':
+        if (pos < packet.size())
+        {
+            writeRegister(REG_PC, parseHex(packet, pos));
+        }
+        reply = resume((packet[0] == 's') ? STEP : CONTINUE);
+        if (reply.empty())
+        {
+            // the debugger went away while running
+            return false;
+        }
+        m_lastStop = reply;
+        break;
+    case 'b':
+        if ((packet == "bc") || (packet == "bs"))
+        {
+            reply = resume((packet == "bs") ? REVERSE_STEP : REVERSE_CONTINUE);
+            if (reply.empty())
+            {
+                return false;
+            }
+            m_lastStop = reply;
+        }
+        break;
+    case 'Z':
+    case 'z':
+        if ((packet.size() > 1) && (packet[1] >= '0') && (packet[1] <= '4'))
+        {
+            reply = breakpoint(packet, packet[0] == 'Z') ? "OK" : "E01";
+        }
+        break;
+    case 'H':
+    case 'T':
+        reply = "OK";
+        break;
+    case 'D':
+        putPacket("OK");
+        m_detach = true;
+        return false;
+    case 'k':
+        return false;
+    case 'q':
+        if (packet.compare(0, 11, "qSupported:") == 0 || (packet == "qSupported"))
+        {
+            reply = "PacketSize=1000;qXfer:features:read+;QStartNoAckMode+;ReverseStep+;ReverseContinue+";
+        }
+        else if (packet == "qAttached")
+        {
+            reply = "1";
+        }
+        else if (packet.compare(0, 31, "qXfer:features:read:target.xml:") == 0)
+        {
+            pos = 31;
+            size_t offset = parseHex(packet, pos);
+            pos++;
+            size_t len = parseHex(packet, pos);
+            std::string xml(g_targetXml);
+            if (offset >= xml.size())
+            {
+                reply = "l";
+            }
+            else
+            {
+                std::string part = xml.substr(offset, len);
+                reply = ((offset + part.size() < xml.size()) ? "m" : "l") + part;
+            }
+        }
+        break;
+    case 'Q':
+        if (packet == "QStartNoAckMode")
+        {
+            putPacket("OK");
+            m_ack = false;
+            return true;
+        }
+        break;
+    default:
+        // unsupported, the empty reply tells the debugger so
+        break;
+    }
+
+    putPacket(reply);
+    return true;
+}
+
+std::string GdbStub::readRegisters()
+{
+    mc6809_state cpu;
+    m_machine.get_state(cpu);
+
+    std::string hex;
+    for(uint32_t reg=0; reg<REG_COUNT; reg++)
+    {
+        hex += toHex(getRegister(cpu, reg), g_regBytes[reg]);
+    }
+    return hex;
+}
+
+void GdbStub::writeRegisters(const std::string &hex)
+{
+    mc6809_state cpu;
+    m_machine.get_state(cpu);
+
+    size_t pos = 0;
+    for(uint32_t reg=0; (reg<REG_D) && (pos + g_regBytes[reg]*2 <= hex.size()); reg++)
+    {
+        uint32_t value = 0;
+        for(uint32_t i=0; i<g_regBytes[reg]*2; i++)
+        {
+            value = (value << 4) | hexValue(hex[pos++]);
+        }
+        setRegister(cpu, reg, value);
+    }
+    m_machine.set_state(cpu);
+    m_machine.restartHistory();
+}
+
+bool GdbStub::writeRegister(uint32_t reg, uint32_t value)
+{
+    if (reg >= REG_COUNT)
+    {
+        return false;
+    }
+
+    mc6809_state cpu;
+    m_machine.get_state(cpu);
+    setRegister(cpu, reg, value);
+    m_machine.set_state(cpu);
+    m_machine.restartHistory();
+    return true;
+}
+
+bool GdbStub::breakpoint(const std::string &packet, bool insert)
+{
+    size_t pos = 3;
+    Word address = static_cast<Word>(parseHex(packet, pos));
+    pos++;
+    uint32_t len = parseHex(packet, pos);
+
+    if ((packet[1] == '0') || (packet[1] == '1'))
+    {
+        if (insert)
+        {
+            return m_machine.addBreakpoint(address);
+        }
+        m_machine.removeBreakpoint(address);
+        return true;
+    }
+
+    Machine::WatchKind kind = (packet[1] == '2') ? Machine::WATCH_WRITE :
+        (packet[1] == '3') ? Machine::WATCH_READ : Machine::WATCH_ACCESS;
+    for(uint32_t i=0; i<len; i++)
+    {
+        Word byte = static_cast<Word>(address + i);
+        if (insert)
+        {
+            if (!m_machine.addWatchpoint(byte, kind))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            m_machine.removeWatchpoint(byte, kind);
+        }
+    }
+    return true;
+}
+
+std::string GdbStub::resume(Resume how)
+{
+    if (how == STEP)
+    {
+        // a breakpoint at pc stops run() before the instruction,
+        // a single step always executes it
+        m_machine.skipBreakpoint();
+        m_machine.step();
+        return "S05";
+    }
+
+    // going back replays the history, which can take
+    // as long as running forward, so it can be interrupted too
+    bool moved = true;
+    m_running = true;
+    std::thread cpu([this, how, &moved]()
+    {
+        switch(how)
+        {
+        case REVERSE_STEP:
+            moved = m_machine.rewind(m_machine.instructions() - 1);
+            break;
+        case REVERSE_CONTINUE:
+            moved = m_machine.reverseContinue();
+            break;
+        default:
+            m_machine.run();
+            break;
+        }
+        m_running = false;
+    });
+
+    // wait for a stop, or for the debugger to interrupt
+    bool interrupted = false;
+    bool closed = false;
+    while(m_running)
+    {
+        if (interrupted || closed || m_quit)
+        {
+            haltRunning(cpu);
+            break;
+        }
+
+        if (m_receivedPos < m_received.size())
+        {
+            int c = getByte();
+            interrupted = (c == 0x03);
+            continue;
+        }
+
+        pollfd fd = {m_client, POLLIN, 0};
+        if (poll(&fd, 1, 10) > 0)
+        {
+            int c = getByte();
+            closed = (c < 0);
+            interrupted = (c == 0x03);
+        }
+    }
+    if (cpu.joinable())
+    {
+        cpu.join();
+    }
+
+    if (closed || m_quit)
+    {
+        return std::string();
+    }
+    else if (!interrupted && !moved)
+    {
+        return "T05replaylog:begin;";
+    }
+    else if ((how == REVERSE_STEP) && !interrupted)
+    {
+        return "S05";
+    }
+    return stopReply(interrupted);
+}
+
+std::string GdbStub::stopReply(bool interrupted)
+{
+    if (interrupted)
+    {
+        return "S02";   // SIGINT
+    }
+
+    switch(m_machine.stopReason())
+    {
+    case Machine::STOP_INVALID:
+        return "S04";   // SIGILL
+    case Machine::STOP_BREAK:
+        {
+            const Machine::BreakHit &hit = m_machine.lastHit();
+            if (hit.access)
+            {
+                return "T05awatch:" + toHex(hit.address, 2) + ";";
+            }
+            else if (hit.type == Machine::BreakHit::WATCH_WRITE)
+            {
+                return "T05watch:" + toHex(hit.address, 2) + ";";
+            }
+            else if (hit.type == Machine::BreakHit::WATCH_READ)
+            {
+                return "T05rwatch:" + toHex(hit.address, 2) + ";";
+            }
+        }
+        return "S05";   // SIGTRAP
+    default:
+        return "S05";
+    }
+}
+
+void GdbStub::runFree()
+{
+    m_running = true;
+    m_free = std::thread([this]()
+    {
+        m_machine.run();
+        m_running = false;
+    });
+}
+
+void GdbStub::stopFree()
+{
+    if (m_free.joinable())
+    {
+        haltRunning(m_free);
+    }
+}
+
+void GdbStub::haltRunning(std::thread &cpu)
+{
+    // run() clears the halt flag when it starts,
+    // so halt until it has returned
+    while(m_running)
+    {
+        m_machine.halt();
+        usleep(1000);
+    }
+    cpu.join();
+}
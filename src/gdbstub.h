@@ -0,0 +1,120 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    GDB remote serial protocol stub: lets a debugger
+    control the machine over a local socket.
+
+*/
+
+#ifndef gdbstub_h
+#define gdbstub_h
+
+#include <stdint.h>
+#include <string>
+#include <thread>
+#include <atomic>
+
+#include "machine.h"
+
+/** serves one debugger connection at a time.
+
+    The machine stays at its current instruction until the
+    first debugger connects. Between stops, it runs on its own
+    thread at full speed while the stub waits for the debugger
+    to interrupt it. After a detach, it runs freely until the
+    next connection stops it again.
+
+    With the machine's history on, reverse-step and
+    reverse-continue go back through its checkpoints. Changing
+    registers or memory starts the history afresh.
+
+    The registers in 'g' packets, in order:
+        cc a b dp x y u s pc e f v md d
+    All are big endian; d is A:B and is ignored when written
+    as part of a 'G' packet. The names are also available as
+    target.xml through qXfer:features:read.
+*/
+class GdbStub
+{
+public:
+    GdbStub(Machine &machine);
+    ~GdbStub();
+
+    GdbStub(const GdbStub&) = delete;
+    GdbStub& operator=(const GdbStub&) = delete;
+
+    /** listen on a TCP port of the loopback interface,
+        or on a unix domain socket if address is not a number */
+    bool listen(const std::string &address);
+
+    /** serve debugger connections until stop() is called */
+    void serve();
+
+    /** make serve() return, may be called from any thread */
+    void stop();
+
+protected:
+    /** handle one connection until it is closed or detached */
+    void session();
+
+    /** read the next packet, false if the connection closed */
+    bool getPacket(std::string &packet);
+
+    /** send a packet and wait for the acknowledgement */
+    void putPacket(const std::string &data);
+
+    /** next byte from the connection, -1 if it closed */
+    int getByte();
+
+    /** process a packet, false ends the session */
+    bool handle(const std::string &packet);
+
+    enum Resume
+    {
+        CONTINUE,
+        STEP,
+        REVERSE_CONTINUE,
+        REVERSE_STEP
+    };
+
+    /** run the machine, returns the stop reply */
+    std::string resume(Resume how);
+
+    /** stop reply for how the machine stopped */
+    std::string stopReply(bool interrupted);
+
+    std::string readRegisters();
+    void writeRegisters(const std::string &hex);
+    bool writeRegister(uint32_t reg, uint32_t value);
+
+    /** insert or remove a Z packet breakpoint or watchpoint */
+    bool breakpoint(const std::string &packet, bool insert);
+
+    /** let the machine run between connections */
+    void runFree();
+    void stopFree();
+
+    /** halt the machine until run() on another thread returns */
+    void haltRunning(std::thread &cpu);
+
+    Machine &m_machine;
+    int m_listen;
+    std::atomic<int> m_client;
+    bool m_ack;                     ///< acknowledge packets, until QStartNoAckMode
+    std::string m_received;         ///< bytes read but not processed yet
+    size_t m_receivedPos;
+    std::string m_lastStop;         ///< reply to '?'
+    std::string m_unixPath;         ///< socket file to remove when done
+    bool m_detach;                  ///< the session ended with a detach
+    std::atomic<bool> m_quit;
+    std::atomic<bool> m_running;    ///< run() is active on a CPU thread
+    std::thread m_free;             ///< CPU thread between connections
+};
+
+#endif
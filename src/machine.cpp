@@ -13,102 +13,1427 @@
 */
 
 #include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "machine.h"
+#include "disasm.h"
+#include "mc6809.tcc"
+#include "mc6809in.tcc"
 
-Machine::Machine()
+template class mc6809_core<Machine>;
+
+Machine::Machine() : m_events(cycles), m_uart(m_events), m_icache(PHYS_ROM + sizeof(m_rom))
+{
+    m_uart.setCpuClock(NOMINAL_MHZ * 1e6);
+    m_instructions = 0;
+    m_profileEntries.resize(1);
+    m_profileData = m_profileEntries.data();
+    m_profileMask = 0;
+    m_profileRequest = false;
+    m_debug = false;
+    m_pagereg = 0;
+    m_lastPC = 0;
+    m_lastCycles = 0;
+    m_mhz = 0.0;
+    m_paceCycles = 0;
+    m_woken = false;
+    m_writes = 0;
+    m_pollPeriod = 0;
+    m_poll = {};
+    m_inputPos = 0;
+    m_scripted = false;
+    m_budgetEvent = 0;
+    m_stopReason = STOP_NONE;
+    m_checked = false;
+    m_breakSkip = false;
+    m_breakCount = 0;
+    m_physFlags.resize(PHYS_SIZE >> 8);
+    m_breakHandler = nullptr;
+    m_breakCtx = nullptr;
+    m_hit = {};
+    m_player = nullptr;
+    m_recordBase = 0;
+    m_playBase = 0;
+    m_historyInterval = 0;
+    m_nextCheckpoint = Scheduler::NEVER;
+    m_historyBytes = 0;
+    m_historyLimit = HISTORY_BYTES;
+    m_stopAt = Scheduler::NEVER;
+
+    // 1 megabyte of memory, banks are allocated when first written
+    auto zero = std::make_shared<Bank>();
+    for(uint32_t bank=0; bank<BANKS; bank++)
+    {
+        m_banks[bank] = zero;
+    }
+
+    // unprogrammed EPROM reads as FF
+    memset(m_rom, 0xFF, sizeof(m_rom));
+
+    hd6309(true);
+
+    mapMemory();
+
+    // peripheral area
+    for(uint32_t page=0xE0; page<0xF0; page++)
+    {
+        m_pages[page] = {nullptr, nullptr, 0, 0};
+    }
+}
+
+Machine::~Machine()
+{
+    stopRecording();
+}
+
+void Machine::hd6309(bool state)
+{
+    CPU::hd6309(state ? 1 : 0);
+    flushCaches();
+}
+
+bool Machine::trace(const std::string &filename)
+{
+    m_trace.reset(new TraceWriter());
+    if (!m_trace->open(filename))
+    {
+        m_trace.reset();
+        return false;
+    }
+    return true;
+}
+
+bool Machine::record(const std::string &filename)
+{
+    ReplayHeader header = {};
+    header.stateHash = stateHash();
+    header.mhz = m_mhz;
+
+    m_recorder.reset(new ReplayLog());
+    if (!m_recorder->create(filename, header))
+    {
+        m_recorder.reset();
+        return false;
+    }
+    m_recordBase = m_instructions;
+    return true;
+}
+
+void Machine::stopRecording()
+{
+    if (m_recorder != nullptr)
+    {
+        m_recorder->append({m_instructions - m_recordBase, cycles, stateHash(), REPLAY_END, {}});
+        m_recorder.reset();
+    }
+}
+
+bool Machine::playback(const std::string &filename)
+{
+    ReplayHeader header;
+    std::unique_ptr<ReplayLog> log(new ReplayLog());
+    if (!log->load(filename, header) || (header.stateHash != stateHash()))
+    {
+        return false;
+    }
+
+    // devices keep the timing of the recording,
+    // but nothing waits for the host clock
+    throttle(0.0);
+    m_uart.setCpuClock(((header.mhz > 0.0) ? header.mhz : NOMINAL_MHZ) * 1e6);
+
+    m_replayFile = std::move(log);
+    m_player = m_replayFile.get();
+    m_playBase = m_instructions;
+    updateChecked();
+    return true;
+}
+
+void Machine::playEvents()
+{
+    uint64_t done = m_instructions - m_playBase;
+    const ReplayEvent *event;
+    while((event = m_player->next()) != nullptr)
+    {
+        if (event->instructions > done)
+        {
+            return;
+        }
+
+        bool diverged = (event->instructions < done);
+        switch(event->type)
+        {
+        case REPLAY_SERIAL:
+            if (diverged || (event->cycles != cycles) || !m_uart.clearToSend())
+            {
+                playbackDone(false);
+                return;
+            }
+            m_uart.submitSerialChar(static_cast<uint8_t>(event->value));
+            updateInterrupts();
+            break;
+        case REPLAY_SLEEP:
+            // taken by wait(), once the guest waits again
+            if (diverged || (!idle() && (m_pollPeriod == 0)))
+            {
+                playbackDone(false);
+            }
+            return;
+        default:
+            playbackDone(!diverged && (event->cycles == cycles) &&
+                (event->value == stateHash()));
+            return;
+        }
+        m_player->pop();
+    }
+}
+
+uint32_t Machine::playBatch() const
+{
+    const ReplayEvent *event = m_player->next();
+    uint64_t done = m_instructions - m_playBase;
+    if (event == nullptr)
+    {
+        return BATCH;
+    }
+    else if (event->instructions <= done)
+    {
+        return 0;
+    }
+    return static_cast<uint32_t>(std::min<uint64_t>(BATCH, event->instructions - done));
+}
+
+void Machine::playbackDone(bool matched)
+{
+    unsigned long long done = m_instructions - m_playBase;
+    if (!matched)
+    {
+        printf("\nReplay diverged at instruction %llu\n", done);
+    }
+    else if (m_player->next() == nullptr)
+    {
+        printf("\nReplay log ended after %llu instructions\n", done);
+    }
+    else
+    {
+        printf("\nReplay matched the recording after %llu instructions\n", done);
+    }
+    m_stopReason = matched ? STOP_REPLAY : STOP_DIVERGED;
+    m_player = nullptr;
+    m_replayFile.reset();
+    updateChecked();
+    CPU::halt();
+}
+
+uint64_t Machine::stateHash() const
+{
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto add = [&hash](const void *data, size_t len)
+    {
+        const uint8_t *p = static_cast<const uint8_t*>(data);
+        for(size_t i=0; i<len; i++)
+        {
+            hash = (hash ^ p[i]) * 0x100000001b3ULL;
+        }
+    };
+
+    mc6809_state cpu;
+    get_state(cpu);
+    UART::State uart;
+    m_uart.getState(uart);
+    DiskIO::State diskio;
+    m_diskio.getState(diskio);
+
+    add(&cpu, sizeof(cpu));
+    add(&uart, sizeof(uart));
+    add(&diskio, sizeof(diskio));
+    add(&m_pagereg, sizeof(m_pagereg));
+    for(uint32_t bank=0; bank<BANKS; bank++)
+    {
+        add(m_banks[bank]->data, BANKSIZE);
+    }
+    add(m_rom, sizeof(m_rom));
+    for(uint8_t drive=0; drive<DiskIO::DRIVES; drive++)
+    {
+        add(m_diskio.image(drive).data(), m_diskio.image(drive).size());
+    }
+    return hash;
+}
+
+void Machine::history(uint64_t interval, size_t maxBytes)
+{
+    m_checkpoints.clear();
+    m_historyLog.seek(0);
+    m_historyLog.truncate();
+    m_historyBytes = 0;
+    m_historyLimit = maxBytes;
+    m_historyInterval = interval;
+    m_nextCheckpoint = Scheduler::NEVER;
+    m_shadow.clear();
+    if (interval == 0)
+    {
+        return;
+    }
+
+    m_shadow.assign(PHYS_SIZE, 0);
+    checkpoint();
+}
+
+void Machine::checkpoint()
+{
+    // the pages that changed since the newest checkpoint go
+    // into it as they were; the shadow then holds the present
+    Checkpoint *prev = m_checkpoints.empty() ? nullptr : &m_checkpoints.back();
+    for(uint32_t phys=0; phys<PHYS_SIZE; phys+=256)
+    {
+        const Byte *live = hostAddress(phys);
+        Byte *shadow = &m_shadow[phys];
+        if (memcmp(live, shadow, 256) != 0)
+        {
+            if (prev != nullptr)
+            {
+                prev->pages.push_back(phys);
+                prev->undo.insert(prev->undo.end(), shadow, shadow + 256);
+                prev->bytes += 256;
+                m_historyBytes += 256;
+            }
+            memcpy(shadow, live, 256);
+        }
+    }
+
+    m_checkpoints.emplace_back();
+    Checkpoint &cp = m_checkpoints.back();
+    cp.instructions = m_instructions;
+    get_state(cp.cpu);
+    m_uart.getState(cp.uart);
+    cp.diskio = m_diskio;
+    cp.poll = m_poll;
+    cp.pollPeriod = m_pollPeriod;
+    cp.writes = m_writes;
+    cp.pagereg = m_pagereg;
+    cp.event = m_historyLog.position();
+    cp.bytes = sizeof(Checkpoint);
+
+    // disk images written since the previous checkpoint
+    // have been copied, so this one holds the old ones
+    for(uint8_t drive=0; (prev != nullptr) && (drive<DiskIO::DRIVES); drive++)
+    {
+        if (&cp.diskio.image(drive) != &prev->diskio.image(drive))
+        {
+            prev->bytes += prev->diskio.image(drive).size();
+            m_historyBytes += prev->diskio.image(drive).size();
+        }
+    }
+    m_historyBytes += cp.bytes;
+    m_nextCheckpoint = m_instructions + m_historyInterval;
+
+    // not while going back, which holds on to checkpoint indices
+    while((m_historyBytes > m_historyLimit) && (m_checkpoints.size() > 2) &&
+        (m_stopAt == Scheduler::NEVER))
+    {
+        m_historyBytes -= m_checkpoints.front().bytes;
+        m_checkpoints.pop_front();
+
+        // the input before the oldest checkpoint isn't needed
+        size_t events = m_checkpoints.front().event;
+        m_historyLog.dropFront(events);
+        for(auto &c : m_checkpoints)
+        {
+            c.event -= events;
+        }
+    }
+}
+
+void Machine::restore(size_t index)
+{
+    // a recording can't follow the machine back
+    stopRecording();
+
+    // memory back to the newest checkpoint,
+    // then through the changes of the later ones
+    for(uint32_t phys=0; phys<PHYS_SIZE; phys+=256)
+    {
+        const Byte *shadow = &m_shadow[phys];
+        if (memcmp(hostAddress(phys), shadow, 256) != 0)
+        {
+            memcpy((phys < PHYS_ROM) ? ramWrite(phys) : hostAddress(phys), shadow, 256);
+        }
+    }
+    while(m_checkpoints.size() > index + 1)
+    {
+        m_historyBytes -= m_checkpoints.back().bytes;
+        m_checkpoints.pop_back();
+
+        Checkpoint &cp = m_checkpoints.back();
+        for(size_t i=0; i<cp.pages.size(); i++)
+        {
+            uint32_t phys = cp.pages[i];
+            const Byte *old = &cp.undo[i*256];
+            memcpy((phys < PHYS_ROM) ? ramWrite(phys) : hostAddress(phys), old, 256);
+            memcpy(&m_shadow[phys], old, 256);
+        }
+        m_historyBytes -= cp.undo.size();
+        cp.bytes -= cp.undo.size();
+        cp.pages.clear();
+        cp.undo.clear();
+    }
+
+    const Checkpoint &cp = m_checkpoints.back();
+    set_state(cp.cpu);
+    m_uart.setState(cp.uart);
+    m_diskio = cp.diskio;
+    m_poll = cp.poll;
+    m_pollPeriod = cp.pollPeriod;
+    m_writes = cp.writes;
+    m_pagereg = cp.pagereg;
+    m_instructions = cp.instructions;
+    m_nextCheckpoint = m_instructions + m_historyInterval;
+    m_breakSkip = false;
+    mapMemory();
+    flushCaches();
+    updateInterrupts();
+
+    m_historyLog.seek(cp.event);
+    m_player = (m_historyLog.next() != nullptr) ? &m_historyLog : nullptr;
+    m_playBase = 0;
+    updateChecked();
+}
+
+bool Machine::runTo(uint64_t count)
+{
+    // the console has seen this output before
+    m_stopAt = count;
+    updateChecked();
+    m_uart.mute(true);
+    run();
+    if ((m_player != nullptr) && (m_instructions == count))
+    {
+        // the loop stops before the input logged at count
+        playEvents();
+    }
+    m_uart.mute(false);
+    m_stopAt = Scheduler::NEVER;
+
+    // the input that is left happened in a future
+    // that won't, the machine continues with new input
+    m_historyLog.truncate();
+    m_player = nullptr;
+    updateChecked();
+    return (m_instructions == count) && (m_stopReason == STOP_HALT);
+}
+
+bool Machine::historyHit(void *ctx, const BreakHit &hit)
+{
+    Machine *m = static_cast<Machine*>(ctx);
+    if (m->m_instructions < m->m_stopAt)
+    {
+        m->m_historyHits.push_back({m->m_instructions, hit});
+    }
+    return false;
+}
+
+bool Machine::rewind(uint64_t count)
+{
+    if (m_checkpoints.empty() || (count > m_instructions) ||
+        (count < m_checkpoints.front().instructions))
+    {
+        return false;
+    }
+
+    size_t index = m_checkpoints.size() - 1;
+    while(m_checkpoints[index].instructions > count)
+    {
+        index--;
+    }
+
+    BreakHandler handler = m_breakHandler;
+    void *ctx = m_breakCtx;
+    setBreakHandler(historyHit, this);
+    restore(index);
+    bool reached = runTo(count);
+    setBreakHandler(handler, ctx);
+    return reached;
+}
+
+bool Machine::reverseContinue()
+{
+    uint64_t target = m_instructions;
+    if (m_checkpoints.empty() || (target <= m_checkpoints.front().instructions))
+    {
+        return false;
+    }
+
+    size_t index = m_checkpoints.size() - 1;
+    while(m_checkpoints[index].instructions >= target)
+    {
+        index--;
+    }
+
+    // execute each interval again with the breakpoints armed,
+    // newest first, until one has hits before the target
+    BreakHandler handler = m_breakHandler;
+    void *ctx = m_breakCtx;
+    setBreakHandler(historyHit, this);
+    bool found = false;
+    while(true)
+    {
+        uint64_t start = m_checkpoints[index].instructions;
+        m_historyHits.clear();
+        restore(index);
+        if (!runTo(target))
+        {
+            break;
+        }
+
+        if (!m_historyHits.empty())
+        {
+            HistoryHit last = m_historyHits.back();
+            restore(index);
+            found = runTo(last.instructions);
+            if (found)
+            {
+                // a breakpoint stops before its instruction
+                m_hit = last.hit;
+                m_breakSkip = (last.hit.type == BreakHit::BREAKPOINT);
+                m_stopReason = STOP_BREAK;
+            }
+            break;
+        }
+
+        if (index == 0)
+        {
+            restore(0);
+            break;
+        }
+        target = start;
+        index--;
+    }
+    setBreakHandler(handler, ctx);
+    return found;
+}
+
+bool Machine::loadRom(const std::string &filename)
+{
+    FILE *fin = fopen(filename.c_str(), "rb");
+    if (fin != 0)
+    {
+        size_t bytes = fread(m_rom, 1, sizeof(m_rom), fin);
+        fclose(fin);
+        flushCaches();
+        return true;
+    }
+    return false;
+}
+
+void Machine::executeCached()
+{
+    Word start = pc;
+    uint64_t before = cycles;
+    uint32_t phys;
+
+    m_instructions++;
+    if (!physical(start, phys))
+    {
+        CPU::execute();
+        return;
+    }
+
+    mc6809_decoded &insn = m_icache.entry(phys);
+    if (insn.len != 0)
+    {
+        replay(insn);
+        profile(phys, before);
+        return;
+    }
+
+    // mark the entry as pending; if the instruction writes
+    // to its own bytes, invalidate() clears the mark again.
+    insn.len = PENDING;
+    CPU::execute();
+    profile(phys, before);
+
+    // only cache instructions that are physically contiguous,
+    // i.e. that don't straddle a page window or run into I/O
+    uint32_t last;
+    if (!halted && (insn.len == PENDING) && capture(insn) &&
+        physical(start + insn.len - 1, last) &&
+        (last == phys + insn.len - 1))
+    {
+        return;
+    }
+    insn.len = 0;
+}
+
+void Machine::executeTraced()
+{
+    Word start = pc;
+    executeCached();
+
+    TraceRecord &rec = m_trace->next();
+    rec = TraceRecord();
+    rec.cycles = cycles;
+    rec.pc = start;
+
+    // the bytes are in the decode cache, or were just fetched
+    // if the instruction could not be cached. They are unknown
+    // only if a cached instruction overwrote itself.
+    uint32_t phys;
+    mc6809_decoded insn;
+    const mc6809_decoded *bytes = nullptr;
+    if (physical(start, phys) && (m_icache.entry(phys).len != 0) &&
+        (m_icache.entry(phys).len != PENDING))
+    {
+        bytes = &m_icache.entry(phys);
+    }
+    else if (capture(insn))
+    {
+        bytes = &insn;
+    }
+    if (bytes != nullptr)
+    {
+        rec.len = bytes->len;
+        memcpy(rec.bytes, bytes->bytes, bytes->len);
+    }
+
+    if ((mode == extended) || (mode == direct) || (mode == indexed))
+    {
+        // only peek at memory, reading I/O has side effects
+        const Page &page = m_pages[ea >> 8];
+        rec.ea = ea;
+        rec.flags = TRACE_EA;
+        if ((page.read != nullptr) || (page.flags & PAGE_WATCH_READ))
+        {
+            rec.value = *hostAddress(page.phys | (ea & 0xFF));
+            rec.flags |= TRACE_VALUE;
+        }
+    }
+
+    rec.d = d;
+    rec.w = w;
+    rec.x = x;
+    rec.y = y;
+    rec.u = u;
+    rec.s = s;
+    rec.v = v;
+    rec.cc = get_cc();
+    rec.dp = dp;
+    rec.md = md;
+    rec.pagereg = m_pagereg;
+    m_trace->commit();
+}
+
+void Machine::executeChecked()
+{
+    const Page &page = m_pages[pc >> 8];
+    if ((page.flags & PAGE_BREAK) && !m_breakSkip)
+    {
+        uint32_t phys = page.phys | (pc & 0xFF);
+        if (((m_breakBits[phys >> 6] >> (phys & 63)) & 1) &&
+            breakHit(BreakHit::BREAKPOINT, pc, phys, *hostAddress(phys), false))
+        {
+            // the next run() or step() executes it
+            m_breakSkip = true;
+            return;
+        }
+    }
+    m_breakSkip = false;
+
+    if (m_debug)
+    {
+        executeTraced();
+    }
+    else
+    {
+        executeCached();
+    }
+}
+
+bool Machine::breakHit(BreakHit::Type type, Word address, uint32_t phys, Byte value, bool access)
+{
+    m_hit = {type, address, phys, value, access};
+
+    // with a trace file, tracing starts at the first hit
+    if ((m_trace != nullptr) && !m_debug)
+    {
+        m_debug = true;
+        updateChecked();
+    }
+
+    if ((m_breakHandler != nullptr) && !m_breakHandler(m_breakCtx, m_hit))
+    {
+        return false;
+    }
+    m_stopReason = STOP_BREAK;
+    CPU::halt();
+    return true;
+}
+
+std::vector<uint32_t> Machine::physicalAddresses(Word address, int bank) const
+{
+    std::vector<uint32_t> phys;
+    if (address < 0x8000)
+    {
+        for(uint32_t b=0; b<BANKS; b++)
+        {
+            if ((bank == ANY_BANK) || (static_cast<uint32_t>(bank) == b))
+            {
+                phys.push_back((b * BANKSIZE) | address);
+            }
+        }
+    }
+    else if (address < 0xE000)
+    {
+        phys.push_back(address);
+    }
+    else if (address >= 0xF000)
+    {
+        phys.push_back(PHYS_ROM + (address - 0xF000));
+    }
+    return phys;
+}
+
+void Machine::updatePageFlags(uint32_t phys)
+{
+    uint32_t first = phys & ~0xFFu;
+    uint8_t flags = 0;
+    if (!m_breakBits.empty())
+    {
+        for(uint32_t word=first >> 6; word<((first + 256) >> 6); word++)
+        {
+            if (m_breakBits[word] != 0)
+            {
+                flags |= PAGE_BREAK;
+            }
+        }
+    }
+    for(auto &watch : m_watches)
+    {
+        if ((watch.phys & ~0xFFu) == first)
+        {
+            flags |= watch.kind;
+        }
+    }
+    m_physFlags[phys >> 8] = flags;
+}
+
+bool Machine::addBreakpoint(Word address, int bank)
+{
+    std::vector<uint32_t> phys = physicalAddresses(address, bank);
+    if (m_breakBits.empty())
+    {
+        m_breakBits.resize(PHYS_SIZE / 64);
+    }
+    for(auto p : phys)
+    {
+        uint64_t bit = uint64_t(1) << (p & 63);
+        if ((m_breakBits[p >> 6] & bit) == 0)
+        {
+            m_breakBits[p >> 6] |= bit;
+            m_breakCount++;
+        }
+        updatePageFlags(p);
+    }
+    mapMemory();
+    updateChecked();
+    return !phys.empty();
+}
+
+void Machine::removeBreakpoint(Word address, int bank)
+{
+    if (m_breakBits.empty())
+    {
+        return;
+    }
+    for(auto p : physicalAddresses(address, bank))
+    {
+        uint64_t bit = uint64_t(1) << (p & 63);
+        if ((m_breakBits[p >> 6] & bit) != 0)
+        {
+            m_breakBits[p >> 6] &= ~bit;
+            m_breakCount--;
+        }
+        updatePageFlags(p);
+    }
+    mapMemory();
+    updateChecked();
+}
+
+bool Machine::addWatchpoint(Word address, WatchKind kind, int32_t value, int bank)
+{
+    std::vector<uint32_t> phys = physicalAddresses(address, bank);
+    for(auto p : phys)
+    {
+        m_watches.push_back({p, kind, value});
+        updatePageFlags(p);
+    }
+    mapMemory();
+    return !phys.empty();
+}
+
+void Machine::removeWatchpoint(Word address, WatchKind kind, int bank)
+{
+    for(auto p : physicalAddresses(address, bank))
+    {
+        m_watches.erase(std::remove_if(m_watches.begin(), m_watches.end(),
+            [p, kind](const Watchpoint &w) { return (w.phys == p) && (w.kind == kind); }),
+            m_watches.end());
+        updatePageFlags(p);
+    }
+    mapMemory();
+}
+
+void Machine::clearBreakpoints()
+{
+    m_breakBits.clear();
+    m_breakCount = 0;
+    m_watches.clear();
+    std::fill(m_physFlags.begin(), m_physFlags.end(), 0);
+    mapMemory();
+    updateChecked();
+}
+
+Byte Machine::peek(Word address)
+{
+    if ((address >= 0xE000) && (address < 0xF000))
+    {
+        return 0;
+    }
+    return *hostAddress(m_pages[address >> 8].phys | (address & 0xFF));
+}
+
+void Machine::poke(Word address, Byte value)
+{
+    if ((address >= 0xE000) && (address < 0xF000))
+    {
+        return;
+    }
+
+    uint32_t phys = m_pages[address >> 8].phys | (address & 0xFF);
+    if (phys < PHYS_ROM)
+    {
+        *ramWrite(phys) = value;
+        mapMemory();
+    }
+    else
+    {
+        *hostAddress(phys) = value;
+    }
+    m_icache.invalidate(phys);
+}
+
+Byte Machine::watchRead(Word address)
+{
+    uint32_t phys = m_pages[address >> 8].phys | (address & 0xFF);
+    Byte value = *hostAddress(phys);
+
+    // instruction bytes are fetched from pc and aren't watched
+    if (address != pc)
+    {
+        for(auto &watch : m_watches)
+        {
+            if ((watch.phys == phys) && (watch.kind & WATCH_READ) &&
+                ((watch.value < 0) || (watch.value == value)))
+            {
+                breakHit(BreakHit::WATCH_READ, address, phys, value, watch.kind == WATCH_ACCESS);
+                break;
+            }
+        }
+    }
+    return value;
+}
+
+void Machine::watchWrite(Word address, Byte value)
+{
+    uint32_t phys = m_pages[address >> 8].phys | (address & 0xFF);
+    for(auto &watch : m_watches)
+    {
+        if ((watch.phys == phys) && (watch.kind & WATCH_WRITE) &&
+            ((watch.value < 0) || (watch.value == value)))
+        {
+            breakHit(BreakHit::WATCH_WRITE, address, phys, value, watch.kind == WATCH_ACCESS);
+            break;
+        }
+    }
+
+    if (phys >= PHYS_ROM)
+    {
+        return;
+    }
+
+    // a shared bank is copied first and has to be remapped
+    bool shared = (m_banks[phys / BANKSIZE].use_count() > 1);
+    *ramWrite(phys) = value;
+    if (shared)
+    {
+        mapMemory();
+    }
+    m_icache.invalidate(phys);
+    m_writes++;
+}
+
+Byte* Machine::bus_span(Word address, Word len, int write)
+{
+    uint32_t first = address >> 8;
+    uint32_t last = (static_cast<uint32_t>(address) + len - 1) >> 8;
+    if ((len == 0) || (last > 0xFF))
+    {
+        return nullptr;
+    }
+
+    Byte *base = write ? m_pages[first].write : m_pages[first].read;
+    if (base == nullptr)
+    {
+        return nullptr;
+    }
+
+    // the pages must follow each other in host memory
+    for(uint32_t page=first+1; page<=last; page++)
+    {
+        Byte *host = write ? m_pages[page].write : m_pages[page].read;
+        if (host != base + ((page - first) << 8))
+        {
+            return nullptr;
+        }
+    }
+
+    if (write)
+    {
+        m_icache.invalidate(m_pages[first].phys | (address & 0xFF), len);
+    }
+    return base + (address & 0xFF);
+}
+
+void Machine::flushCaches()
+{
+    m_icache.flush();
+}
+
+void Machine::run()
+{
+    m_paceStart = std::chrono::steady_clock::now();
+    m_paceCycles = cycles;
+
+    m_stopReason = STOP_NONE;
+    halted = false;
+    while (!halted.load(std::memory_order_relaxed) && (m_instructions < m_stopAt))
+    {
+        if (m_instructions >= m_nextCheckpoint)
+        {
+            checkpoint();
+        }
+        drainMailbox();
+        uint32_t batch = static_cast<uint32_t>(std::min<uint64_t>(BATCH, m_stopAt - m_instructions));
+        if (m_player != nullptr)
+        {
+            playEvents();
+            batch = (m_player != nullptr) ? std::min(batch, playBatch()) : 0;
+        }
+        if (cycles >= m_events.next())
+        {
+            // events that came due while sleeping
+            runEvents();
+        }
+        for(uint32_t i=0; (i<batch) && !halted.load(std::memory_order_relaxed) &&
+            !idle() && (m_pollPeriod == 0); i++)
+        {
+            execute();
+            if (cycles >= m_events.next())
+            {
+                runEvents();
+            }
+        }
+        m_lastPC.store(pc, std::memory_order_relaxed);
+        m_lastCycles.store(cycles, std::memory_order_relaxed);
+
+        if (m_profileRequest.exchange(false))
+        {
+            saveProfile();
+        }
+
+        if ((m_scripted || !m_promptState.empty()) && waitingForInput())
+        {
+            promptReached();
+        }
+        else if (idle())
+        {
+            wait();
+        }
+        else if (m_pollPeriod != 0)
+        {
+            wait(m_pollPeriod);
+            m_pollPeriod = 0;
+        }
+
+        if (m_mhz > 0.0)
+        {
+            pace();
+        }
+    }
+
+    if (m_stopReason == STOP_NONE)
+    {
+        m_stopReason = STOP_HALT;
+    }
+    status();
+}
+
+void Machine::promptReached()
 {
-    m_trace = false;
-    m_debug = false;
-    m_pagereg = 0;
-    m_breakpoint = -1;
-    m_memory = new Byte[1024*1024]; // 1 megabyte of memory!
+    m_pollPeriod = 0;
+    if ((m_inputPos < m_input.size()) && m_uart.clearToSend())
+    {
+        recordEvent(REPLAY_SERIAL, static_cast<uint8_t>(m_input[m_inputPos]));
+        m_uart.submitSerialChar(m_input[m_inputPos++]);
+        updateInterrupts();
+        return;
+    }
+
+    if (!m_promptState.empty())
+    {
+        if (saveState(m_promptState))
+        {
+            printf("\nSaved state to %s\n", m_promptState.c_str());
+        }
+        else
+        {
+            printf("\nFailed to save state to %s\n", m_promptState.c_str());
+        }
+        m_promptState.clear();
+    }
+    m_stopReason = STOP_INPUT;
+    CPU::halt();
 }
 
-Machine::~Machine()
+void Machine::profile(const std::string &filename)
 {
-    delete[] m_memory;
+    m_profileFile = filename;
+    m_profileEntries.assign(PROFILE_SIZE, {0, 0});
+    m_profileData = m_profileEntries.data();
+    m_profileMask = PROFILE_SIZE - 1;
 }
 
-bool Machine::loadRom(const std::string &filename)
+bool Machine::saveProfile()
 {
-    std::unique_lock<std::mutex> locker(m_mutex);
-    FILE *fin = fopen(filename.c_str(), "rb");
-    if (fin != 0)
+    if (m_profileMask == 0)
     {
-        size_t bytes = fread(m_rom, 1, sizeof(m_rom), fin);
-        fclose(fin);
-        return true;
+        return false;
     }
-    return false;
-}
 
-Byte Machine::read(Word address)
-{
-    if (address < 0x8000)
+    uint64_t totalCount = 0;
+    uint64_t totalCycles = 0;
+    std::vector<uint32_t> hot;
+    for(uint32_t phys=0; phys<PROFILE_SIZE; phys++)
     {
-        // paged RAM area
-        uint32_t addr = static_cast<uint32_t>(m_pagereg & 31) << 15;
-        addr |= address;
-        return m_memory[addr];
+        if (m_profileData[phys].count != 0)
+        {
+            hot.push_back(phys);
+            totalCount += m_profileData[phys].count;
+            totalCycles += m_profileData[phys].cycles;
+        }
     }
-    else if (address < 0xE000)
+
+    // hottest addresses by cycles spent first
+    size_t top = std::min<size_t>(hot.size(), PROFILE_TOP);
+    std::partial_sort(hot.begin(), hot.begin() + top, hot.end(),
+        [this](uint32_t p1, uint32_t p2)
+        {
+            return m_profileData[p1].cycles > m_profileData[p2].cycles;
+        });
+
+    FILE *fout = (m_profileFile == "-") ? stdout : fopen(m_profileFile.c_str(), "wt");
+    if (fout == 0)
     {
-        // non-paged RAM area
-        return m_memory[address];
+        return false;
     }
-    else if (address < 0xF000)
+
+    fprintf(fout, "Profile: %llu instructions, %llu cycles at %zu addresses\n",
+        static_cast<unsigned long long>(totalCount),
+        static_cast<unsigned long long>(totalCycles), hot.size());
+    fprintf(fout, "  phys  bank:offs  addr %14s %7s %14s %7s  instruction\n", "count", "%", "cycles", "%");
+    for(size_t i=0; i<top; i++)
     {
-        // peripheral area
-        if ((address >= 0xE000) && (address < 0xE010))
+        uint32_t phys = hot[i];
+        const ProfileEntry &entry = m_profileData[phys];
+        char where[32];
+        uint32_t address;
+        uint32_t avail;     // bytes up to the end of the bank or ROM
+        if (phys >= PHYS_ROM)
         {
-            return m_uart.read(address - 0xE000);
+            address = 0xF000 + phys - PHYS_ROM;
+            avail = PHYS_SIZE - phys;
+            snprintf(where, sizeof(where), "       ROM  %04X", address);
         }
-        else if ((address >= 0xE020) && (address < 0xE030))
+        else
         {
-            return m_diskio.readReg(address - 0xE020);
+            // bank 1 below 0xE000 is the fixed area at 0x8000,
+            // everything else is seen through the paged window
+            uint32_t bank = phys / BANKSIZE;
+            uint32_t offset = phys % BANKSIZE;
+            address = ((bank == 1) && (offset < 0x6000)) ? 0x8000 + offset : offset;
+            avail = BANKSIZE - offset;
+            snprintf(where, sizeof(where), "%05X    %02X:%04X  %04X", phys, bank, offset, address);
         }
-        return 0;
+
+        char text[48];
+        disassemble(is6309 != 0, address, hostAddress(phys),
+            std::min<uint32_t>(avail, mc6809_decoded::max_len), text, sizeof(text));
+
+        fprintf(fout, "%s %14llu %6.2f%% %14llu %6.2f%%  %s\n", where,
+            static_cast<unsigned long long>(entry.count),
+            100.0 * entry.count / totalCount,
+            static_cast<unsigned long long>(entry.cycles),
+            (totalCycles != 0) ? 100.0 * entry.cycles / totalCycles : 0.0, text);
+    }
+
+    if (fout != stdout)
+    {
+        fclose(fout);
     }
-    else 
+    else
     {
-        // ROM area
-        return m_rom[address-0xF000];
+        fflush(stdout);
     }
+    return true;
 }
 
-void Machine::write(Word address, Byte value)
+void Machine::setBudget(uint64_t budget)
 {
-    if (address < 0x8000)
+    if (m_budgetEvent != 0)
     {
-        // paged RAM area
-        uint32_t addr = static_cast<uint32_t>(m_pagereg & 31) << 15;
-        addr |= address;
-        m_memory[addr] = value;
+        m_events.cancel(m_budgetEvent);
+        m_budgetEvent = 0;
     }
-    else if (address < 0xE000)
+    if (budget != 0)
+    {
+        m_budgetEvent = m_events.after(budget, budgetDone, this);
+    }
+}
+
+void Machine::budgetDone(void *ctx, uint32_t /*tag*/)
+{
+    Machine *m = static_cast<Machine*>(ctx);
+    m->m_budgetEvent = 0;
+    m->m_stopReason = STOP_BUDGET;
+    m->CPU::halt();
+}
+
+void Machine::pace()
+{
+    // cycles divided by MHz gives microseconds of guest time
+    int64_t guest = static_cast<int64_t>((cycles - m_paceCycles) / m_mhz);
+    int64_t host  = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - m_paceStart).count();
+
+    if (guest - host >= PACE_SLICE)
     {
-        // non-paged RAM area
-        m_memory[address] = value;
+        usleep(guest - host);
     }
-    else if (address < 0xF000)
+    else if (host - guest > PACE_SLACK)
     {
-        // peripheral area
-        if ((address >= 0xE000) && (address < 0xE010))
+        // too far behind, e.g. after tracing; don't try
+        // to catch up in a burst but start pacing afresh.
+        m_paceStart = std::chrono::steady_clock::now();
+        m_paceCycles = cycles;
+    }
+}
+
+void Machine::halt()
+{
+    CPU::halt();
+    wake();
+}
+
+void Machine::wake()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_woken = true;
+    }
+    m_sleepCond.notify_one();
+}
+
+void Machine::sleep(uint64_t period)
+{
+    uint64_t deadline = m_events.next();
+    // whole periods needed to reach the deadline
+    uint64_t toDeadline = (deadline > cycles) ? deadline - cycles : 0;
+    toDeadline = ((toDeadline + period - 1) / period) * period;
+
+    if ((deadline != Scheduler::NEVER) && (m_mhz <= 0.0))
+    {
+        // nothing happens before the next event,
+        // unless a message is already waiting
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        if (m_woken)
+        {
+            m_woken = false;
+        }
+        else
         {
-            m_uart.write(address - 0xE000, value);
+            cycles += toDeadline;
         }
-        else if ((address >= 0xE020) && (address < 0xE030))
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool timedOut = false;
+    {
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        auto woken = [this]{ return m_woken || halted; };
+        if (deadline != Scheduler::NEVER)
+        {
+            auto until = m_paceStart + std::chrono::microseconds(
+                static_cast<int64_t>((deadline - m_paceCycles) / m_mhz));
+            timedOut = !m_sleepCond.wait_until(lock, until, woken);
+        }
+        else
+        {
+            m_sleepCond.wait(lock, woken);
+        }
+        m_woken = false;
+    }
+
+    if (m_mhz > 0.0)
+    {
+        // the CPU clock keeps running while the guest waits
+        int64_t us = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        uint64_t slept = static_cast<uint64_t>(us * m_mhz);
+        slept -= slept % period;
+        if (timedOut && (slept < toDeadline))
         {
-            m_diskio.writeReg(address - 0xE020, value);
-        }        
-        else if (address == 0xE800)
+            slept = toDeadline;
+        }
+        cycles += slept;
+    }
+}
+
+void Machine::wait(uint64_t period)
+{
+    if (m_player == nullptr)
+    {
+        sleep(period);
+        recordEvent(REPLAY_SLEEP, 0);
+        return;
+    }
+
+    const ReplayEvent *event = m_player->next();
+    if (event == nullptr)
+    {
+        // the recording was cut short
+        playbackDone(true);
+    }
+    else if ((event->type != REPLAY_SLEEP) || (event->cycles < cycles) ||
+        (event->instructions != m_instructions - m_playBase))
+    {
+        playbackDone(false);
+    }
+    else
+    {
+        cycles = event->cycles;
+        m_player->pop();
+    }
+}
+
+void Machine::runEvents()
+{
+    m_events.run();
+    updateInterrupts();
+}
+
+void Machine::checkPoll(Word address, Byte value)
+{
+    PollState now = {pc, address, value, get_cc(), dp, md,
+        d, w, v, x, y, u, s, m_writes, cycles};
+
+    // the guest came back to the same read without changing
+    // anything, so it keeps doing so until the UART changes
+    if (now.sameLoop(m_poll))
+    {
+        m_pollPeriod = now.cycles - m_poll.cycles;
+    }
+    m_poll = now;
+}
+
+void Machine::updateInterrupts()
+{
+    irq(m_uart.irq());
+}
+
+void Machine::throttle(double mhz)
+{
+    m_mhz = mhz;
+    m_uart.setCpuClock(((mhz > 0.0) ? mhz : NOMINAL_MHZ) * 1e6);
+}
+
+void Machine::drainMailbox()
+{
+    const Message *msg;
+    while((msg = m_mailbox.front()) != nullptr)
+    {
+        switch(msg->type)
         {
-            m_pagereg = value;
+        case Message::SERIAL:
+            if ((m_player != nullptr) || (m_stopAt != Scheduler::NEVER))
+            {
+                // the input comes from the log, the console
+                // waits until the machine is back in the present
+                return;
+            }
+            if (!m_uart.clearToSend())
+            {
+                // the guest hasn't read the previous character yet
+                return;
+            }
+            recordEvent(REPLAY_SERIAL, static_cast<uint8_t>(msg->value));
+            m_uart.submitSerialChar(msg->value);
+            updateInterrupts();
+            break;
+        case Message::DEBUG:
+            m_debug = (msg->value != 0) && (m_trace != nullptr);
+            updateChecked();
+            break;
         }
+        m_mailbox.pop();
+    }
+}
+
+void Machine::mapBank()
+{
+    uint32_t bank = static_cast<uint32_t>(m_pagereg & 31) << 15;
+    for(uint32_t page=0x00; page<0x80; page++)
+    {
+        mapRam(page, bank | (page << 8));
+    }
+}
+
+void Machine::mapMemory()
+{
+    // paged RAM area
+    mapBank();
+
+    // non-paged RAM area
+    for(uint32_t page=0x80; page<0xE0; page++)
+    {
+        mapRam(page, page << 8);
+    }
+
+    // ROM area
+    for(uint32_t page=0xF0; page<0x100; page++)
+    {
+        uint32_t phys = PHYS_ROM + ((page - 0xF0) << 8);
+        uint8_t flags = m_physFlags[phys >> 8];
+        Byte *host = (flags & PAGE_WATCH_READ) ? nullptr : hostAddress(phys);
+        m_pages[page] = {host, nullptr, phys, flags};
+    }
+}
+
+void Machine::mapRam(uint32_t page, uint32_t phys)
+{
+    const std::shared_ptr<Bank> &bank = m_banks[phys / BANKSIZE];
+    Byte *host = bank->data + (phys % BANKSIZE);
+    uint8_t flags = m_physFlags[phys >> 8];
+    bool readOnly = (bank.use_count() > 1) || (flags & PAGE_WATCH_WRITE);
+    m_pages[page] = {(flags & PAGE_WATCH_READ) ? nullptr : host, readOnly ? nullptr : host, phys, flags};
+}
+
+Byte* Machine::ramWrite(uint32_t phys)
+{
+    std::shared_ptr<Bank> &bank = m_banks[phys / BANKSIZE];
+    if (bank.use_count() > 1)
+    {
+        bank = std::make_shared<Bank>(*bank);
+    }
+    return bank->data + (phys % BANKSIZE);
+}
+
+void Machine::writeShared(Word address, Byte value)
+{
+    // the other machines may have dropped the bank by now,
+    // otherwise this takes a private copy of it
+    ramWrite(m_pages[address >> 8].phys);
+    mapMemory();
+    bus_write(address, value);
+}
+
+Machine* Machine::fork()
+{
+    Machine *clone = new Machine();
+
+    mc6809_state cpu;
+    get_state(cpu);
+    clone->set_state(cpu);
+    clone->lazy_flags(lazycc);
+
+    for(uint32_t bank=0; bank<BANKS; bank++)
+    {
+        clone->m_banks[bank] = m_banks[bank];
+    }
+    memcpy(clone->m_rom, m_rom, sizeof(m_rom));
+    clone->m_pagereg = m_pagereg;
+
+    UART::State uart;
+    m_uart.getState(uart);
+    clone->m_uart.setState(uart);
+    clone->m_diskio = m_diskio;
+
+    clone->throttle(m_mhz);
+    clone->m_breakBits = m_breakBits;
+    clone->m_breakCount = m_breakCount;
+    clone->m_watches = m_watches;
+    clone->m_physFlags = m_physFlags;
+    clone->updateChecked();
+    clone->m_lastPC = pc;
+    clone->m_lastCycles = cycles;
+
+    // both machines now copy a bank before writing to it
+    mapMemory();
+    clone->mapMemory();
+    return clone;
+}
+
+Byte Machine::ioRead(Word address)
+{
+    drainAtIO();
+    if ((address >= 0xE000) && (address < 0xE010))
+    {
+        // UART reads have no side effects once repeated,
+        // so polling them can be detected
+        Byte value = m_uart.read(address - 0xE000);
+        updateInterrupts();
+        checkPoll(address, value);
+        return value;
+    }
+    else if ((address >= 0xE020) && (address < 0xE030))
+    {
+        return m_diskio.readReg(address - 0xE020);
+    }
+    return 0;
+}
+
+void Machine::ioWrite(Word address, Byte value)
+{
+    m_writes++;
+    drainAtIO();
+    if ((address >= 0xE000) && (address < 0xE010))
+    {
+        m_uart.write(address - 0xE000, value);
+        updateInterrupts();
+    }
+    else if ((address >= 0xE020) && (address < 0xE030))
+    {
+        m_diskio.writeReg(address - 0xE020, value);
     }
-    else 
+    else if (address == 0xE800)
     {
-        // ROM area, so do nothing..
+        // the decode cache is keyed by physical address,
+        // so switching banks needs no invalidation
+        m_pagereg = value;
+        mapBank();
     }
 }
 
@@ -138,14 +1463,11 @@ static uint32_t hexchar(uint8_t c)
 
 bool Machine::loadHex(const std::string &filename)
 {
-    std::unique_lock<std::mutex> locker(m_mutex);
 
     int state = 0;
     uint32_t address;
     uint8_t data;
 
-    printf("Loading %s\n", filename.c_str());
-
     FILE *fin = fopen(filename.c_str(), "rt");
     if (fin == 0)
     {
@@ -206,18 +1528,11 @@ bool Machine::loadHex(const std::string &filename)
         case 6:
             data <<= 4;
             data |= hexchar(c);
-            if (address < 0xE000)
-            {
-                //if ((address >= 0xCD00) && (address <= 0xCE00))
-                //{
-                //    printf("  %02X\n", data);
-                //}
-                m_memory[address] = data;
-            }
-            else if (address >= 0xF000)
-            {
-                m_rom[address-0xF000] = data;
-            }
+            //if ((address >= 0xCD00) && (address <= 0xCE00))
+            //{
+            //    printf("  %02X\n", data);
+            //}
+            loadByte(address, data);
             state++;
             address++;
             break;
@@ -240,11 +1555,176 @@ bool Machine::loadHex(const std::string &filename)
     }
 
     fclose(fin);
+    mapMemory();
+    flushCaches();
     return true;
 }
 
+void Machine::loadByte(uint32_t address, Byte data)
+{
+    if (address < 0xE000)
+    {
+        *ramWrite(address) = data;
+    }
+    else if ((address >= 0xF000) && (address < 0x10000))
+    {
+        m_rom[address-0xF000] = data;
+    }
+}
+
+void Machine::loadBytes(uint32_t address, const Byte *data, size_t len)
+{
+    for(size_t i=0; i<len; i++)
+    {
+        loadByte(address + i, data[i]);
+    }
+    mapMemory();
+    flushCaches();
+}
+
 bool Machine::mountDisk(uint8_t drive, const std::string &filename)
 {
-    std::unique_lock<std::mutex> locker(m_mutex);
     return m_diskio.loadImage(drive, filename);
 }
+
+static uint64_t alignUp(uint64_t offset, uint64_t align)
+{
+    return (offset + align - 1) / align * align;
+}
+
+static bool writeAt(FILE *fout, uint64_t offset, const void *data, size_t bytes)
+{
+    if (bytes == 0)
+    {
+        return true;
+    }
+    return (fseek(fout, offset, SEEK_SET) == 0) &&
+        (fwrite(data, 1, bytes, fout) == bytes);
+}
+
+bool Machine::saveState(const std::string &filename)
+{
+    SnapshotHeader header = {};
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    header.version = SNAPSHOT_VERSION;
+    header.headerSize = sizeof(header);
+    get_state(header.cpu);
+    m_uart.getState(header.uart);
+    m_diskio.getState(header.diskio);
+    header.pagereg = m_pagereg;
+    memcpy(header.rom, m_rom, sizeof(m_rom));
+
+    uint64_t offset = alignUp(sizeof(header), SNAPSHOT_ALIGN);
+    header.ramOffset = offset;
+    offset = alignUp(offset + RAMSIZE, SNAPSHOT_ALIGN);
+    for(uint8_t drive=0; drive<DiskIO::DRIVES; drive++)
+    {
+        header.diskOffset[drive] = offset;
+        header.diskSize[drive] = m_diskio.image(drive).size();
+        offset = alignUp(offset + header.diskSize[drive], SNAPSHOT_ALIGN);
+    }
+
+    FILE *fout = fopen(filename.c_str(), "wb");
+    if (fout == 0)
+    {
+        return false;
+    }
+
+    bool ok = writeAt(fout, 0, &header, sizeof(header));
+    for(uint32_t bank=0; ok && (bank<BANKS); bank++)
+    {
+        ok = writeAt(fout, header.ramOffset + bank*BANKSIZE, m_banks[bank]->data, BANKSIZE);
+    }
+    for(uint8_t drive=0; ok && (drive<DiskIO::DRIVES); drive++)
+    {
+        ok = writeAt(fout, header.diskOffset[drive],
+            m_diskio.image(drive).data(), header.diskSize[drive]);
+    }
+
+    return (fclose(fout) == 0) && ok;
+}
+
+bool Machine::loadState(const std::string &filename)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat info;
+    if ((fstat(fd, &info) != 0) || (static_cast<size_t>(info.st_size) < sizeof(SnapshotHeader)))
+    {
+        close(fd);
+        return false;
+    }
+
+    size_t size = info.st_size;
+    void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+    {
+        return false;
+    }
+
+    const Byte *file = static_cast<const Byte*>(map);
+    const SnapshotHeader *header = static_cast<const SnapshotHeader*>(map);
+
+    // every section has to lie within the file
+    auto inFile = [size](uint64_t offset, uint64_t bytes)
+    {
+        return (offset <= size) && (bytes <= size - offset);
+    };
+
+    bool ok = (memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) == 0) &&
+        (header->version == SNAPSHOT_VERSION) &&
+        (header->headerSize == sizeof(SnapshotHeader)) &&
+        inFile(header->ramOffset, RAMSIZE);
+    for(uint8_t drive=0; ok && (drive<DiskIO::DRIVES); drive++)
+    {
+        ok = inFile(header->diskOffset[drive], header->diskSize[drive]);
+    }
+
+    if (ok)
+    {
+        set_state(header->cpu);
+        // banks that hold nothing but zeros are shared
+        std::shared_ptr<Bank> zero;
+        for(uint32_t bank=0; bank<BANKS; bank++)
+        {
+            const Byte *data = file + header->ramOffset + bank*BANKSIZE;
+            if ((data[0] == 0) && (memcmp(data, data + 1, BANKSIZE - 1) == 0))
+            {
+                if (!zero)
+                {
+                    zero = std::make_shared<Bank>();
+                }
+                m_banks[bank] = zero;
+            }
+            else
+            {
+                m_banks[bank] = std::make_shared<Bank>();
+                memcpy(m_banks[bank]->data, data, BANKSIZE);
+            }
+        }
+        memcpy(m_rom, header->rom, sizeof(m_rom));
+        m_pagereg = header->pagereg;
+        mapMemory();
+
+        m_uart.setState(header->uart);
+        m_diskio.setState(header->diskio);
+        for(uint8_t drive=0; drive<DiskIO::DRIVES; drive++)
+        {
+            m_diskio.setImage(drive, file + header->diskOffset[drive], header->diskSize[drive]);
+        }
+
+        m_poll = {};
+        m_pollPeriod = 0;
+        m_lastPC = pc;
+        m_lastCycles = cycles;
+        flushCaches();
+    }
+
+    munmap(map, size);
+    return ok;
+}
@@ -17,14 +17,28 @@
 
 #include <stdint.h>
 #include <unistd.h>
+#include <vector>
+#include <deque>
+#include <atomic>
+#include <chrono>
+#include <memory>
 #include <mutex>
+#include <condition_variable>
 
 #include "mc6809.h"
 #include "uart.h"
 #include "diskio.h"
+#include "decodecache.h"
+#include "mailbox.h"
+#include "scheduler.h"
+#include "trace.h"
+#include "replay.h"
 
-class Machine : public mc6809
+class Machine : public mc6809_core<Machine>
 {
+    friend class mc6809_core<Machine>;
+    typedef mc6809_core<Machine> CPU;
+
 public:
     Machine();
     virtual ~Machine();
@@ -35,13 +49,16 @@ public:
     /** load a HEX file into RAM */
     bool loadHex(const std::string &filename);
 
+    /** copy bytes into RAM (below 0xE000) or ROM (0xF000 and up),
+        bytes for the peripheral area are dropped */
+    void loadBytes(uint32_t address, const Byte *data, size_t len);
+
     /** returns true if the UART will accept
         data via submitSerialChar()
     */
-    bool clearToSend()
+    bool clearToSend() const
     {
-        std::unique_lock<std::mutex> locker(m_mutex);
-        return m_uart.clearToSend();
+        return !m_mailbox.full();
     }
 
     /** place a character in the UARTs receive buffer
@@ -49,73 +66,736 @@ public:
     */
     void submitSerialChar(uint8_t c)
     {
-        std::unique_lock<std::mutex> locker(m_mutex);
-        m_uart.submitSerialChar(c);
+        m_mailbox.push({Message::SERIAL, c});
+        wake();
     }    
 
     virtual void execute() override
     {
-        std::unique_lock<std::mutex> locker(m_mutex);
-
-        if (static_cast<int32_t>(pc) == m_breakpoint)
+        if (poll_interrupts())
         {
-            //halt();
-            m_debug = true;
+            return;
         }
-        
-        if (m_debug)
-        {
-            printf("PC: %04X -> %02X\n\tSP: %04X\tA: %02X\tB: %02X\n", pc, read(pc), s, (int32_t)a, (int32_t)b);
-            printf("\tDD: %04X\tX : %04X\tY: %04X\n", d, x, y);
-            //printf("\tHEX: %02X%02X\n", read(0xDEFC+1), read(0xDEFC));
-            mc6809::execute();
-            usleep(1000*250);
+
+        if (m_checked)
+        {
+            executeChecked();
         }
         else
         {
-            mc6809::execute();
+            executeCached();
         }
     }
 
-    uint32_t getPC()
+    /** run the CPU in batches until halted */
+    virtual void run() override;
+
+    /** stop run(), may be called from any thread */
+    virtual void halt() override;
+
+    /** PC as of the last batch boundary */
+    uint32_t getPC() const
     {
-        std::unique_lock<std::mutex> locker(m_mutex);
-        return pc;
+        return m_lastPC.load(std::memory_order_relaxed);
     }
 
-    void setBreakpoint(int32_t breakpoint)
+    /** CPU cycles as of the last batch boundary */
+    uint64_t getCycles() const
     {
-        std::unique_lock<std::mutex> locker(m_mutex);
-        m_breakpoint = breakpoint;
+        return m_lastCycles.load(std::memory_order_relaxed);
     }
 
+    /** instructions executed since the machine was created */
+    uint64_t instructions() const
+    {
+        return m_instructions;
+    }
+
+    /** start or stop writing instructions to the trace file */
     void debug(bool state)
     {
-        std::unique_lock<std::mutex> locker(m_mutex);
-        m_debug = state;
+        m_mailbox.push({Message::DEBUG, state ? 1 : 0});
+        wake();
     }
 
+    /* The functions below change the machine directly
+       and must not be called while run() is active. */
+
+    /** select the HD6309 or MC6809 instruction set. Decoded
+        instructions refer to the dispatch table of one set,
+        so the decode cache is dropped. */
+    void hd6309(bool state);
+
+    /** open a binary trace file, see trace.h. Instructions are
+        recorded after debug(true) or from the breakpoint on. */
+    bool trace(const std::string &filename);
+
+    /** log the console input and the time the guest spends
+        waiting from now on, so playback() can repeat the run
+        exactly. Call it after loading and reset, as the log
+        starts from the current state. */
+    bool record(const std::string &filename);
+
+    /** end the recording; the log gets the final state,
+        which playback() checks */
+    void stopRecording();
+
+    /** take console input and waiting times from a recorded
+        log and run unthrottled. The machine must be in the
+        state the recording started from; run() stops with
+        STOP_REPLAY or STOP_DIVERGED at the end of the log. */
+    bool playback(const std::string &filename);
+
+    /** hash of the CPU, memory, device and disk state */
+    uint64_t stateHash() const;
+
+    static constexpr size_t HISTORY_BYTES = 64*1024*1024;
+
+    /** keep checkpoints every interval instructions from now on,
+        so rewind() and reverseContinue() can go back in time.
+        Checkpoints hold the memory pages that changed since the
+        previous one; the oldest are dropped once they add up to
+        more than maxBytes. 0 turns the history off. */
+    void history(uint64_t interval, size_t maxBytes = HISTORY_BYTES);
+
+    /** forget the history and start it again from the current
+        state, e.g. after the debugger changed registers or memory */
+    void restartHistory()
+    {
+        history(m_historyInterval, m_historyLimit);
+    }
+
+    /** go back to the point where count instructions had been
+        executed, by restoring the checkpoint before it and
+        executing forward with the input of the original run.
+        Returns false if that is before the oldest checkpoint or
+        ahead of the current instruction, or if halt() was called.
+        What happened after the point is forgotten; the machine
+        continues from there with new input. */
+    bool rewind(uint64_t count);
+
+    /** go back to the last breakpoint or watchpoint hit before
+        the current instruction, see lastHit(). Without one, go
+        back to the oldest checkpoint and return false. */
+    bool reverseContinue();
+
+    /** pace execution to a CPU clock in MHz, 0 runs unthrottled */
+    void throttle(double mhz);
+
     /** mount a DSK file as a drive */
     bool mountDisk(uint8_t drive, const std::string &filename);
 
+    /** write the CPU, memory, device and disk state to a file */
+    bool saveState(const std::string &filename);
+
+    /** restore a state written by saveState(), instead
+        of loading ROM and disks and resetting the CPU */
+    bool loadState(const std::string &filename);
+
+    /** let run() save the state and return once the guest
+        first waits for console input, e.g. at its prompt.
+        With script(), this happens after the script is done. */
+    void saveStateAtPrompt(const std::string &filename)
+    {
+        m_promptState = filename;
+    }
+
+    /** add input for a run without a console. Each time the
+        guest waits for input, the next character is put in the
+        UART. run() returns once the guest waits again after the
+        last character. */
+    void script(const std::string &input)
+    {
+        m_input.erase(0, m_inputPos);
+        m_inputPos = 0;
+        m_input += input;
+        m_scripted = true;
+    }
+
+    /** send console output to handler instead of stdout */
+    void setConsole(UART::OutputHandler handler, void *ctx)
+    {
+        m_uart.setOutput(handler, ctx);
+    }
+
+    /** count executions and cycles per physical address of
+        each instruction from now on, the report goes to a file
+        or to stdout for "-" */
+    void profile(const std::string &filename);
+
+    /** write the profile report, only while run() is not active
+        or from the CPU thread */
+    bool saveProfile();
+
+    /** let run() write the profile report at its next batch,
+        may be called from any thread */
+    void requestProfile()
+    {
+        m_profileRequest = true;
+        wake();
+    }
+
+    static constexpr int ANY_BANK = -1;
+
+    /** stop before executing address. Below 0x8000, this is the
+        address in the given RAM bank, or in all of them. Returns
+        false for the peripheral area. */
+    bool addBreakpoint(Word address, int bank = ANY_BANK);
+    void removeBreakpoint(Word address, int bank = ANY_BANK);
+
+    enum WatchKind : uint8_t
+    {
+        WATCH_READ   = 0x01,
+        WATCH_WRITE  = 0x02,
+        WATCH_ACCESS = 0x03
+    };
+
+    /** stop after an instruction that reads or writes address,
+        only when value is written or read if it isn't negative.
+        Instruction fetches are not watched. */
+    bool addWatchpoint(Word address, WatchKind kind, int32_t value = -1, int bank = ANY_BANK);
+    void removeWatchpoint(Word address, WatchKind kind, int bank = ANY_BANK);
+
+    /** remove all breakpoints and watchpoints */
+    void clearBreakpoints();
+
+    /** read memory as currently mapped for the CPU, without
+        watchpoints. The peripheral area reads as 0, as reading
+        its registers has side effects. */
+    Byte peek(Word address);
+
+    /** write RAM or ROM as currently mapped for the CPU,
+        writes to the peripheral area are dropped */
+    void poke(Word address, Byte value);
+
+    /** what made run() stop with STOP_BREAK */
+    struct BreakHit
+    {
+        enum Type : uint8_t
+        {
+            BREAKPOINT,
+            WATCH_READ,
+            WATCH_WRITE
+        } type;
+        Word     address;   ///< breakpoint or watched address
+        uint32_t phys;      ///< physical address
+        Byte     value;     ///< value read or written
+        bool     access;    ///< the watchpoint is a WATCH_ACCESS one
+    };
+
+    /** called on the CPU thread for each hit, returns
+        true to stop run(), false to continue */
+    typedef bool (*BreakHandler)(void *ctx, const BreakHit &hit);
+
+    /** replace the default handler, which always stops */
+    void setBreakHandler(BreakHandler handler, void *ctx)
+    {
+        m_breakHandler = handler;
+        m_breakCtx = ctx;
+    }
+
+    const BreakHit& lastHit() const
+    {
+        return m_hit;
+    }
+
+    /** execute the instruction at pc on the next run() or
+        step() even if a breakpoint is set there */
+    void skipBreakpoint()
+    {
+        m_breakSkip = true;
+    }
+
+    /** let run() return after another budget cycles,
+        0 removes the budget */
+    void setBudget(uint64_t budget);
+
+    /** execute one instruction and the device events it makes due */
+    virtual void step() override
+    {
+        execute();
+        if (cycles >= m_events.next())
+        {
+            runEvents();
+        }
+    }
+
+    /** why run() returned */
+    enum StopReason
+    {
+        STOP_NONE,
+        STOP_HALT,      ///< halt() was called
+        STOP_INVALID,   ///< the guest ran an illegal instruction
+        STOP_BUDGET,    ///< the cycle budget ran out
+        STOP_INPUT,     ///< the guest waits for input that isn't scripted
+        STOP_BREAK,     ///< a breakpoint or watchpoint was hit, see lastHit()
+        STOP_REPLAY,    ///< playback reached the end of the log
+        STOP_DIVERGED   ///< playback no longer matches the recording
+    };
+
+    StopReason stopReason() const
+    {
+        return m_stopReason;
+    }
+
+    /** create a copy of the machine that continues from the
+        current state. RAM banks and disk images are shared
+        until one of the machines writes to them. The caller
+        owns the copy. */
+    Machine* fork();
+
 protected:
-    std::mutex m_mutex;
+    /** execute one instruction through the decode cache */
+    void executeCached();
+
+    /** execute one instruction and append it to the trace */
+    void executeTraced();
 
-    bool    m_debug;
-    bool    m_trace;
+    /** execute one instruction with breakpoints armed or tracing */
+    void executeChecked();
+
+    /** report a hit, returns true if run() stops */
+    bool breakHit(BreakHit::Type type, Word address, uint32_t phys, Byte value, bool access);
+
+    /** physical addresses of address in bank, or in all banks
+        for ANY_BANK. Empty for the peripheral area. */
+    std::vector<uint32_t> physicalAddresses(Word address, int bank) const;
+
+    /** recompute the flags of a physical page and remap memory */
+    void updatePageFlags(uint32_t phys);
+
+    /** set m_checked from tracing, the breakpoints, playback
+        and a pending runTo() stop */
+    void updateChecked()
+    {
+        m_checked = m_debug || (m_breakCount != 0) || (m_player != nullptr) ||
+            (m_stopAt != Scheduler::NEVER);
+    }
+
+    /** accesses to pages with watchpoints */
+    Byte watchRead(Word address);
+    void watchWrite(Word address, Byte value);
+
+    /** host memory of a physical RAM or ROM address */
+    Byte* hostAddress(uint32_t phys)
+    {
+        return (phys < PHYS_ROM) ? m_banks[phys / BANKSIZE]->data + (phys % BANKSIZE) :
+            m_rom + (phys - PHYS_ROM);
+    }
+
+    /** invalidate all decoded code */
+    void flushCaches();
+
+    /** translate a CPU address into a physical address,
+        returns false if the address is not RAM or ROM */
+    bool physical(Word address, uint32_t &phys) const
+    {
+        const Page &page = m_pages[address >> 8];
+        phys = page.phys | (address & 0xFF);
+        return page.read != nullptr;
+    }
+
+    static constexpr uint32_t RAMSIZE  = 1024*1024;
+    static constexpr uint32_t BANKSIZE = 32*1024;   ///< RAM selected by the page register
+    static constexpr uint32_t BANKS    = RAMSIZE / BANKSIZE;
+    static constexpr uint32_t PHYS_ROM = RAMSIZE;   ///< physical address of ROM
+    static constexpr uint32_t PHYS_SIZE = PHYS_ROM + 4096;
+    static constexpr Byte PENDING = 0xFF;           ///< decode cache entry being filled
+    static constexpr uint32_t BATCH = 1024;         ///< execute() calls between mailbox checks
+    static constexpr double NOMINAL_MHZ = 3.6864;   ///< CPU clock for device timing when not throttled
+
+    /** message from the console thread to the CPU thread */
+    struct Message
+    {
+        enum Type : uint8_t
+        {
+            SERIAL,         ///< character for the UART
+            DEBUG           ///< start/stop tracing
+        } type;
+        int32_t value;
+    };
+
+    /** handle queued messages, called from the CPU thread only */
+    void drainMailbox();
+
+    /** handle queued messages at a device access, for quick
+        input. Not while recording or keeping history: the log
+        only places input between instructions, so it then waits
+        for the batch. */
+    void drainAtIO()
+    {
+        if ((m_recorder == nullptr) && (m_historyInterval == 0))
+        {
+            drainMailbox();
+        }
+    }
+
+    /** set the CPU interrupt lines from the device outputs */
+    void updateInterrupts();
+
+    /** run the device events that are due */
+    void runEvents();
+
+    /** block the CPU thread until a message arrives or the
+        machine is halted, used while the guest waits for an
+        interrupt in CWAI or SYNC or polls an unchanging device.
+        When throttled, the cycle count advances by the time
+        slept, rounded down to a multiple of period. If a device
+        event is pending, the sleep ends at its deadline; when
+        not throttled, guest time skips straight to it. */
+    void sleep(uint64_t period = 1);
+
+    /** sleep() and log the cycles slept when recording, or
+        take them from the log when playing back */
+    void wait(uint64_t period = 1);
+
+    /** log an input event when recording, and keep
+        it for going back in time */
+    void recordEvent(ReplayEventType type, uint64_t value)
+    {
+        if (m_recorder != nullptr)
+        {
+            m_recorder->append({m_instructions - m_recordBase, cycles, value, type, {}});
+        }
+        if ((m_historyInterval != 0) && (m_player == nullptr))
+        {
+            m_historyLog.push({m_instructions, cycles, value, type, {}});
+        }
+    }
+
+    /** playback: apply the events due at this instruction */
+    void playEvents();
+
+    /** playback: instructions to execute before the next event */
+    uint32_t playBatch() const;
+
+    /** playback: stop run() at the end of the log */
+    void playbackDone(bool matched);
+
+    std::unique_ptr<ReplayLog> m_recorder;
+    std::unique_ptr<ReplayLog> m_replayFile;
+    ReplayLog *m_player;        ///< m_replayFile or m_historyLog while playing back
+    uint64_t m_recordBase;      ///< m_instructions when recording started
+    uint64_t m_playBase;        ///< m_instructions when playback started
+
+    /** wake a sleeping CPU thread */
+    void wake();
+
+    /** sleep until the host has caught up with guest time */
+    void pace();
+
+    static constexpr int64_t PACE_SLICE = 1000;     ///< minimum sleep in us
+    static constexpr int64_t PACE_SLACK = 100000;   ///< largest lag in us that is made up
+
+    /** CPU state at a device register read. When a read finds
+        the same state as the previous one, with no memory or
+        device writes in between, the guest is in a loop that
+        can only end once the device changes. */
+    struct PollState
+    {
+        Word     pc;
+        Word     address;
+        Byte     value;
+        Byte     cc;
+        Byte     dp;
+        Byte     md;
+        Word     d, w, v, x, y, u, s;
+        uint32_t writes;    ///< m_writes at the read
+        uint64_t cycles;    ///< cycles at the read
+
+        bool sameLoop(const PollState &o) const
+        {
+            return (pc == o.pc) && (address == o.address) && (value == o.value) &&
+                (cc == o.cc) && (dp == o.dp) && (md == o.md) &&
+                (d == o.d) && (w == o.w) && (v == o.v) && (x == o.x) &&
+                (y == o.y) && (u == o.u) && (s == o.s) && (writes == o.writes);
+        }
+    };
+
+    /** snapshot file header, in host byte order. RAM and the
+        disk images follow at page aligned offsets so the file
+        can be used through a single mapping. */
+    struct SnapshotHeader
+    {
+        char          magic[8];     ///< SNAPSHOT_MAGIC
+        uint32_t      version;      ///< SNAPSHOT_VERSION
+        uint32_t      headerSize;   ///< sizeof(SnapshotHeader)
+        mc6809_state  cpu;
+        UART::State   uart;
+        DiskIO::State diskio;
+        uint8_t       pagereg;
+        uint8_t       pad[7];
+        uint64_t      ramOffset;
+        uint64_t      diskOffset[DiskIO::DRIVES];
+        uint64_t      diskSize[DiskIO::DRIVES];
+        Byte          rom[4096];
+    };
+
+    static constexpr char SNAPSHOT_MAGIC[9] = "HD6309SS";
+    static constexpr uint32_t SNAPSHOT_VERSION = 1;
+    static constexpr uint64_t SNAPSHOT_ALIGN = 4096;
+
+    /** true if the guest waits for console input and no
+        device event other than the end of the budget is due */
+    bool waitingForInput() const
+    {
+        return (idle() || (m_pollPeriod != 0)) && (m_mailbox.front() == nullptr) &&
+            (m_events.pending() == ((m_budgetEvent != 0) ? 1u : 0u));
+    }
+
+    /** type the next scripted character, or stop run() and save
+        the state if requested. Called when waitingForInput(). */
+    void promptReached();
+
+    /** scheduler callback: the cycle budget is used up */
+    static void budgetDone(void *ctx, uint32_t tag);
+
+    std::string m_promptState;  ///< save file for saveStateAtPrompt()
+    std::string m_input;        ///< script()
+    size_t      m_inputPos;     ///< next character of m_input
+    bool        m_scripted;
+    Scheduler::EventId m_budgetEvent;  ///< ends run(), 0 if there is no budget
+    StopReason  m_stopReason;
+
+    /** execution profile of one physical address */
+    struct ProfileEntry
+    {
+        uint64_t count;
+        uint64_t cycles;
+    };
+
+    /** add an instruction at phys that started at cycle before
+        to the profile. Without profiling, the mask is 0 and all
+        instructions land in a single dummy entry, so there is
+        no branch. */
+    void profile(uint32_t phys, uint64_t before)
+    {
+        ProfileEntry &entry = m_profileData[phys & m_profileMask];
+        entry.count++;
+        entry.cycles += cycles - before;
+    }
+
+    static constexpr uint32_t PROFILE_SIZE = 2*RAMSIZE;    ///< power of two above ROM
+    static constexpr uint32_t PROFILE_TOP  = 50;            ///< lines in the report
+
+    std::vector<ProfileEntry> m_profileEntries;
+    ProfileEntry *m_profileData;
+    uint32_t m_profileMask;
+    std::string m_profileFile;
+    std::atomic<bool> m_profileRequest;
+
+    /** check a UART register read for a polling loop */
+    void checkPoll(Word address, Byte value);
+
+    PollState m_poll;       ///< state at the last UART read
+    uint32_t  m_writes;     ///< count of memory and device writes
+    uint64_t  m_pollPeriod; ///< cycles per loop iteration, 0 if not polling
+
+    /** machine state at a checkpoint */
+    struct Checkpoint
+    {
+        uint64_t     instructions;
+        mc6809_state cpu;
+        UART::State  uart;
+        DiskIO       diskio;    ///< shares the disk images until they are written
+        PollState    poll;
+        uint64_t     pollPeriod;
+        uint32_t     writes;
+        uint8_t      pagereg;
+        size_t       event;     ///< first input event after the checkpoint
+        size_t       bytes;     ///< memory held by the checkpoint
+        std::vector<uint32_t> pages;    ///< physical pages changed by the next checkpoint
+        std::vector<Byte>     undo;     ///< and their contents at this one
+    };
+
+    /** take a checkpoint, called from run() between batches */
+    void checkpoint();
+
+    /** go back to a checkpoint and drop the ones after it */
+    void restore(size_t index);
+
+    /** run until count instructions have been executed, taking
+        input from the history. Returns false if run() stopped
+        before that. */
+    bool runTo(uint64_t count);
+
+    /** break handler while going back: note the hit and continue */
+    static bool historyHit(void *ctx, const BreakHit &hit);
+
+    /** a breakpoint or watchpoint hit while executing forward */
+    struct HistoryHit
+    {
+        uint64_t instructions;
+        BreakHit hit;
+    };
+
+    std::deque<Checkpoint>  m_checkpoints;
+    std::vector<Byte>       m_shadow;       ///< memory at the newest checkpoint
+    std::vector<HistoryHit> m_historyHits;
+    ReplayLog m_historyLog;     ///< input since the oldest checkpoint, by instruction count
+    uint64_t  m_historyInterval;///< instructions between checkpoints, 0 without history
+    uint64_t  m_nextCheckpoint; ///< instruction count of the next checkpoint
+    size_t    m_historyBytes;   ///< memory held by all checkpoints
+    size_t    m_historyLimit;
+    uint64_t  m_stopAt;         ///< run() returns once this many instructions are executed
+
+    double   m_mhz;         ///< target clock rate, 0 for unthrottled
+    uint64_t m_paceCycles;  ///< cycle count at m_paceStart
+    std::chrono::steady_clock::time_point m_paceStart;
+
+    Mailbox<Message, 256> m_mailbox;
+    std::mutex m_sleepMutex;
+    std::condition_variable m_sleepCond;
+    bool m_woken;           ///< set by wake(), protected by m_sleepMutex
+    std::atomic<uint32_t> m_lastPC;
+    std::atomic<uint64_t> m_lastCycles;
+
+    uint64_t m_instructions;
+
+    bool    m_debug;        ///< tracing, only with m_trace
+    bool    m_checked;      ///< execute through executeChecked()
+    bool    m_breakSkip;    ///< the stop was at a breakpoint, execute it on resume
     uint8_t m_pagereg;
 
-    int32_t m_breakpoint;
+    /** a watched physical address */
+    struct Watchpoint
+    {
+        uint32_t  phys;
+        WatchKind kind;
+        int32_t   value;    ///< value to match, negative for any
+    };
+
+    /** flags of a page with breakpoints or watchpoints */
+    enum PageFlags : uint8_t
+    {
+        PAGE_WATCH_READ  = WATCH_READ,
+        PAGE_WATCH_WRITE = WATCH_WRITE,
+        PAGE_BREAK       = 0x04
+    };
+
+    std::vector<uint64_t>   m_breakBits;    ///< bit per physical address, allocated by the first breakpoint
+    uint32_t                m_breakCount;   ///< bits set in m_breakBits
+    std::vector<Watchpoint> m_watches;
+    std::vector<uint8_t>    m_physFlags;    ///< PageFlags per physical page
+    BreakHandler m_breakHandler;
+    void        *m_breakCtx;
+    BreakHit     m_hit;
+
+    /** one entry per 256 byte page of the CPU address space.
+        Pages with read watchpoints have no read pointer and
+        pages with write watchpoints no write pointer, so only
+        their accesses leave the fast path of the bus. */
+    struct Page
+    {
+        Byte     *read;     ///< host memory to read, nullptr for I/O
+        Byte     *write;    ///< host memory to write, nullptr for I/O and ROM
+        uint32_t  phys;     ///< physical address of the page
+        uint8_t   flags;    ///< PageFlags
+    };
+
+    Page m_pages[256];
+
+    /** memory bus of the CPU core, resolved at compile time */
+    Byte bus_read(Word address)
+    {
+        const Page &page = m_pages[address >> 8];
+        if (page.read != nullptr)
+        {
+            return page.read[address & 0xFF];
+        }
+        else if (page.flags & PAGE_WATCH_READ)
+        {
+            return watchRead(address);
+        }
+        return ioRead(address);
+    }
+
+    void bus_write(Word address, Byte value)
+    {
+        const Page &page = m_pages[address >> 8];
+        if (page.write != nullptr)
+        {
+            page.write[address & 0xFF] = value;
+            m_icache.invalidate(page.phys | (address & 0xFF));
+            m_writes++;
+        }
+        else if (page.flags & (PAGE_WATCH_READ | PAGE_WATCH_WRITE))
+        {
+            watchWrite(address, value);
+        }
+        else if (page.read == nullptr)
+        {
+            ioWrite(address, value);
+        }
+        else if (page.phys < PHYS_ROM)
+        {
+            writeShared(address, value);
+        }
+        // else: ROM, so do nothing..
+    }
+
+    /** write to a RAM bank that is mapped read-only because
+        it is shared with a forked machine */
+    void writeShared(Word address, Byte value);
+
+    /** host pointer to len bytes of memory at address for block
+        transfers, or nullptr if the range is not contiguous memory */
+    Byte* bus_span(Word address, Word len, int write);
+
+    /** peripheral area, 0xE000 .. 0xEFFF */
+    Byte ioRead(Word address);
+    void ioWrite(Word address, Byte value);
+
+    /** point the low 128 pages at the selected RAM bank */
+    void mapBank();
+
+    /** map all RAM pages, shared banks are mapped read-only */
+    void mapMemory();
+
+    /** map one CPU page to physical RAM */
+    void mapRam(uint32_t page, uint32_t phys);
+
+    /** place a byte of a loaded image in RAM or ROM,
+        mapMemory() has to be called afterwards */
+    void loadByte(uint32_t address, Byte data);
+
+    /** host pointer to write physical RAM without going through
+        the page table, copies the bank first if it is shared.
+        mapMemory() has to be called afterwards. */
+    Byte* ramWrite(uint32_t phys);
+
+    virtual Byte read(Word address) override
+    {
+        return bus_read(address);
+    }
+
+    virtual void write(Word address, Byte value) override
+    {
+        bus_write(address, value);
+    }
 
-	  virtual Byte read(Word) override;
-	  virtual void write(Word, Byte) override;
     virtual void status() override;
 
-    Byte *m_memory;
+    virtual void invalid(const char *msg) override
+    {
+        m_stopReason = STOP_INVALID;
+        CPU::invalid(msg);
+    }
+
+    /** a bank of RAM, shared between forked machines until written */
+    struct Bank
+    {
+        Byte data[BANKSIZE];
+    };
+
+    std::shared_ptr<Bank> m_banks[BANKS];
     Byte m_rom[4096];
 
+    Scheduler m_events;
     UART m_uart;
     DiskIO m_diskio;
+    DecodeCache m_icache;
+    std::unique_ptr<TraceWriter> m_trace;
 };
 
 #endif
\ No newline at end of file
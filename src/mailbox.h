@@ -0,0 +1,77 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    Lock-free single-producer/single-consumer mailbox
+    for passing messages from the console thread to the
+    CPU thread.
+
+*/
+
+#ifndef mailbox_h
+#define mailbox_h
+
+#include <stdint.h>
+#include <atomic>
+
+/** fixed size SPSC ring buffer.
+
+    push() may only be called from one thread and
+    front()/pop() from one other thread.
+*/
+template<typename T, uint32_t N>
+class Mailbox
+{
+public:
+    Mailbox() : m_head(0), m_tail(0) {}
+
+    /** producer: append an item, returns false if the mailbox is full */
+    bool push(const T &item)
+    {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        if ((head - m_tail.load(std::memory_order_acquire)) == N)
+        {
+            return false;
+        }
+        m_items[head % N] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** producer: returns true if push() would fail */
+    bool full() const
+    {
+        return (m_head.load(std::memory_order_relaxed) -
+            m_tail.load(std::memory_order_acquire)) == N;
+    }
+
+    /** consumer: return the oldest item or nullptr if empty */
+    const T* front() const
+    {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+        return &m_items[tail % N];
+    }
+
+    /** consumer: remove the oldest item, the mailbox must not be empty */
+    void pop()
+    {
+        m_tail.store(m_tail.load(std::memory_order_relaxed) + 1,
+            std::memory_order_release);
+    }
+
+protected:
+    T m_items[N];
+    std::atomic<uint32_t> m_head;   ///< written by the producer
+    std::atomic<uint32_t> m_tail;   ///< written by the consumer
+};
+
+#endif
@@ -21,12 +21,84 @@
 #include <unistd.h>
 #include <termios.h>
 #include <thread>
+#include <signal.h>
 
 #include "cxxopts.hpp"
 
 #include "machine.h"
+#include "batch.h"
+#include "gdbstub.h"
 
 termios g_oldTerminal;
+volatile sig_atomic_t g_signal = 0;
+
+void onSignal(int sig)
+{
+    g_signal = sig;
+}
+
+/** catch a signal without restarting reads, so the
+    console loop sees it */
+void catchSignal(int sig)
+{
+    struct sigaction action = {};
+    action.sa_handler = onSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(sig, &action, nullptr);
+}
+
+/** print a breakpoint or watchpoint hit and the registers,
+    then let the machine continue */
+bool printHit(void *ctx, const Machine::BreakHit &hit)
+{
+    Machine *machine = static_cast<Machine*>(ctx);
+    switch(hit.type)
+    {
+    case Machine::BreakHit::BREAKPOINT:
+        printf("Breakpoint at %04X\n", hit.address);
+        break;
+    case Machine::BreakHit::WATCH_READ:
+        printf("Watchpoint: read %02X from %04X\n", hit.value, hit.address);
+        break;
+    case Machine::BreakHit::WATCH_WRITE:
+        printf("Watchpoint: write %02X to %04X\n", hit.value, hit.address);
+        break;
+    }
+
+    mc6809_state cpu;
+    machine->get_state(cpu);
+    printf("\tS : %04X\tA: %02X\tB: %02X\n", cpu.s, cpu.d >> 8, cpu.d & 0xFF);
+    printf("\tDD: %04X\tX : %04X\tY: %04X\tCC: %02X\n", cpu.d, cpu.x, cpu.y, cpu.cc);
+    return false;
+}
+
+/** with a trace, hits only start tracing */
+bool continueAfterHit(void * /*ctx*/, const Machine::BreakHit & /*hit*/)
+{
+    return false;
+}
+
+/** add watchpoints given as HEX or HEX=VALUE */
+bool addWatchpoints(Machine &machine, const std::vector<std::string> &specs, Machine::WatchKind kind)
+{
+    for(auto &spec : specs)
+    {
+        char *end;
+        Word address = static_cast<Word>(strtol(spec.c_str(), &end, 16));
+        int32_t value = -1;
+        if (*end == '=')
+        {
+            value = static_cast<int32_t>(strtol(end + 1, NULL, 16)) & 0xFF;
+        }
+        if (!machine.addWatchpoint(address, kind, value))
+        {
+            printf("Cannot watch %s\n", spec.c_str());
+            return false;
+        }
+        printf("Watching %s of %04X\n", (kind == Machine::WATCH_READ) ? "reads" : "writes", address);
+    }
+    return true;
+}
 
 void rawMode()
 {
@@ -43,6 +115,52 @@ void restoreMode()
     tcsetattr( STDIN_FILENO, TCSANOW, &g_oldTerminal);
 }
 
+/** run the jobs of a manifest without a console and print
+    a line per job, console output goes to outdir/name.log */
+int runBatch(const std::string &manifest, const std::string &outdir, uint32_t threads)
+{
+    std::vector<BatchJob> jobs;
+    if (!loadManifest(manifest, jobs))
+    {
+        return 1;
+    }
+
+    BatchRunner runner(jobs);
+    runner.run(threads);
+
+    int status = 0;
+    for(size_t i=0; i<jobs.size(); i++)
+    {
+        const BatchResult &result = runner.results()[i];
+        if (!result.error.empty())
+        {
+            printf("%-24s error: %s\n", jobs[i].name.c_str(), result.error.c_str());
+            status = 1;
+            continue;
+        }
+
+        printf("%-24s %-8s %14llu cycles %8zu bytes\n", jobs[i].name.c_str(),
+            stopReasonName(result.reason),
+            static_cast<unsigned long long>(result.cycles),
+            result.output.size());
+
+        if (!outdir.empty())
+        {
+            std::string logname = outdir + "/" + jobs[i].name + ".log";
+            FILE *fout = fopen(logname.c_str(), "wb");
+            if (fout == 0)
+            {
+                printf("Cannot write %s\n", logname.c_str());
+                status = 1;
+                continue;
+            }
+            fwrite(result.output.data(), 1, result.output.size(), fout);
+            fclose(fout);
+        }
+    }
+    return status;
+}
+
 int main(int argc, char *argv[])
 {
     printf("######################################################################\n");
@@ -52,15 +170,43 @@ int main(int argc, char *argv[])
 
     cxxopts::Options options("hd6309sim", "A simulator for the HD6309 computer");
 
-    bool debug = false;
+    std::string trace;
+    bool eagerFlags = false;
+    bool mc6809 = false;
+    double mhz = 0.0;
+    std::string saveState;
+    std::string loadState;
+    std::string profile;
+    std::string batch;
+    std::string gdb;
+    std::string record;
+    uint32_t history = 1;
+    std::string replay;
+    std::string batchOut;
+    uint32_t threads = std::thread::hardware_concurrency();
     Machine machine;
-    int32_t breakpoint = -1;
+    bool breakpoints = false;
 
     options.show_positional_help();
     options.add_options()
-        ("b,break", "Set a breakpoint at HEX address", cxxopts::value<std::string>())
-        ("trace", "Enable 6809 trace/debugger", cxxopts::value<bool>(debug))
+        ("b,break", "Set a breakpoint at HEX address, may be repeated", cxxopts::value<std::vector<std::string>>())
+        ("watch", "Watch writes to HEX address, or of a value with HEX=VALUE", cxxopts::value<std::vector<std::string>>())
+        ("rwatch", "Watch reads from HEX address, or of a value with HEX=VALUE", cxxopts::value<std::vector<std::string>>())
+        ("trace", "Write every instruction to a binary trace file, from the breakpoint on if one is set", cxxopts::value<std::string>(trace))
+        ("eager-flags", "Evaluate condition codes after every instruction", cxxopts::value<bool>(eagerFlags))
+        ("mc6809", "Disable the HD6309 instructions", cxxopts::value<bool>(mc6809))
+        ("mhz", "Throttle to a CPU clock in MHz, e.g. 3.579545", cxxopts::value<double>(mhz))
         ("d,disk", "Add a .DSK image as a drive", cxxopts::value<std::vector<std::string>>())
+        ("save-state", "Run until the guest waits for input, save the machine state to a file and exit", cxxopts::value<std::string>(saveState))
+        ("load-state", "Start from a saved machine state instead of booting", cxxopts::value<std::string>(loadState))
+        ("profile", "Profile execution per physical address, report to a file or - at exit and on SIGUSR1", cxxopts::value<std::string>(profile))
+        ("record", "Log the console input to a file for --replay", cxxopts::value<std::string>(record))
+        ("replay", "Run unthrottled without a console, with the input logged by --record", cxxopts::value<std::string>(replay))
+        ("gdb", "Wait for a GDB connection on a local TCP port or a unix socket path", cxxopts::value<std::string>(gdb))
+        ("history", "Checkpoint every N million instructions for reverse execution in GDB, 0 disables", cxxopts::value<uint32_t>(history))
+        ("batch", "Run the jobs of a manifest file without a console", cxxopts::value<std::string>(batch))
+        ("batch-out", "Directory for the console output of batch jobs", cxxopts::value<std::string>(batchOut))
+        ("j,jobs", "Number of threads for batch jobs", cxxopts::value<uint32_t>(threads))
         ("help", "Print help")
         ("hex", "Hex file", cxxopts::value<std::vector<std::string>>())
     ;
@@ -75,20 +221,54 @@ int main(int argc, char *argv[])
             return 0;
         }
 
+        if (!batch.empty())
+        {
+            return runBatch(batch, batchOut, threads);
+        }
+
         if (result.count("break"))
         {
-            std::string hexnum = result["break"].as<std::string>();
-            breakpoint = (int)strtol(hexnum.c_str(), NULL, 16);
-            printf("Setting breakpoint address: %04X\n", breakpoint);
-            machine.setBreakpoint(breakpoint);
-        }    
+            for(auto &hexnum : result["break"].as<std::vector<std::string> >())
+            {
+                Word breakpoint = static_cast<Word>(strtol(hexnum.c_str(), NULL, 16));
+                printf("Setting breakpoint address: %04X\n", breakpoint);
+                if (!machine.addBreakpoint(breakpoint))
+                {
+                    printf("Cannot set a breakpoint at %04X\n", breakpoint);
+                    return 1;
+                }
+            }
+            breakpoints = true;
+        }
+
+        if (result.count("watch") &&
+            !addWatchpoints(machine, result["watch"].as<std::vector<std::string> >(), Machine::WATCH_WRITE))
+        {
+            return 1;
+        }
+        if (result.count("rwatch") &&
+            !addWatchpoints(machine, result["rwatch"].as<std::vector<std::string> >(), Machine::WATCH_READ))
+        {
+            return 1;
+        }
+        breakpoints = breakpoints || result.count("watch") || result.count("rwatch");
 
-        if (result.count("hex") > 0)
+        if (!loadState.empty())
+        {
+            if (!machine.loadState(loadState))
+            {
+                printf("Failed to load state %s\n", loadState.c_str());
+                return 1;
+            }
+            printf("Loaded state %s\n", loadState.c_str());
+        }
+        else if (result.count("hex") > 0)
         {
             auto &v = result["hex"].as<std::vector<std::string> >();
 
             for(auto hexfile : v)
             {
+                printf("Loading %s\n", hexfile.c_str());
                 if (!machine.loadHex(hexfile.c_str()))
                 {
                     printf("Failed to load %s\n", hexfile.c_str());
@@ -130,22 +310,125 @@ int main(int argc, char *argv[])
     }    
     
 
-    if (debug)
+    if (!trace.empty())
+    {
+        if (!machine.trace(trace))
+        {
+            printf("Cannot create trace file %s\n", trace.c_str());
+            return 1;
+        }
+        printf("Tracing to %s\n", trace.c_str());
+        machine.debug(!breakpoints);
+        machine.setBreakHandler(continueAfterHit, nullptr);
+    }
+    else
+    {
+        machine.setBreakHandler(printHit, &machine);
+    }
+
+    machine.lazy_flags(!eagerFlags);
+    machine.throttle(mhz);
+    if (loadState.empty())
     {
-        printf("Debugging enabled\n");
+        machine.hd6309(!mc6809);
+        machine.reset();
     }
 
-    machine.debug(debug);
-    machine.reset();
+    if (!profile.empty())
+    {
+        machine.profile(profile);
+        catchSignal(SIGUSR1);
+    }
 
-    std::thread t1(&Machine::run, &machine);
+    // let the profile, trace and recording be finished on ^C
+    if (!profile.empty() || !trace.empty() || !record.empty())
+    {
+        catchSignal(SIGINT);
+        catchSignal(SIGTERM);
+    }
+
+    if (!record.empty())
+    {
+        if (!machine.record(record))
+        {
+            printf("Cannot create %s\n", record.c_str());
+            return 1;
+        }
+        printf("Recording input to %s\n", record.c_str());
+    }
+
+    if (!replay.empty())
+    {
+        if (!machine.playback(replay))
+        {
+            printf("Cannot replay %s, it isn't a replay log or was recorded from another start state\n",
+                replay.c_str());
+            return 1;
+        }
+        printf("Replaying %s\n", replay.c_str());
+    }
+
+    if (!saveState.empty() || !replay.empty())
+    {
+        // run without a console
+        if (!saveState.empty())
+        {
+            machine.saveStateAtPrompt(saveState);
+        }
+        machine.run();
+        machine.saveProfile();
+        return (machine.stopReason() == Machine::STOP_DIVERGED) ? 1 : 0;
+    }
+
+    // signals have to interrupt the console read, so
+    // the CPU thread must not take them
+    sigset_t signals, oldSignals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGUSR1);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &oldSignals);
+    std::unique_ptr<GdbStub> stub;
+    std::thread t1;
+    if (!gdb.empty())
+    {
+        stub.reset(new GdbStub(machine));
+        if (!stub->listen(gdb))
+        {
+            printf("Cannot listen for GDB on %s\n", gdb.c_str());
+            return 1;
+        }
+        printf("Waiting for GDB on %s\n", gdb.c_str());
+        machine.history(static_cast<uint64_t>(history) * 1000000);
+        catchSignal(SIGINT);
+        catchSignal(SIGTERM);
+        t1 = std::thread(&GdbStub::serve, stub.get());
+    }
+    else
+    {
+        t1 = std::thread(&Machine::run, &machine);
+    }
+    pthread_sigmask(SIG_SETMASK, &oldSignals, nullptr);
 
     rawMode();
 
     bool quit = false;
     while(!quit)
     {
-        uint8_t c = getchar();
+        int ch = getchar();
+        if (g_signal == SIGUSR1)
+        {
+            g_signal = 0;
+            machine.requestProfile();
+            clearerr(stdin);
+            continue;
+        }
+        else if (g_signal != 0)
+        {
+            break;
+        }
+
+        uint8_t c = ch;
         switch(c)
         {
         //case 'Q':
@@ -155,28 +438,28 @@ int main(int argc, char *argv[])
         //    printf("PC = %04X\n", machine.getPC());
         //    break;
         case 127: // backspace ?!?
-            while(!machine.clearToSend()) 
+            while(!machine.clearToSend() && (g_signal == 0))
             {
                 usleep(1000);  // 1ms sleep
             }
             machine.submitSerialChar(8);
             break;
         case 27:    //escape
-            while(!machine.clearToSend()) 
+            while(!machine.clearToSend() && (g_signal == 0))
             {
                 usleep(1000);  // 1ms sleep
             }
             machine.submitSerialChar(27);
             break;
         case 10:
-            while(!machine.clearToSend()) 
+            while(!machine.clearToSend() && (g_signal == 0))
             {
                 usleep(1000);  // 1ms sleep
             }
             machine.submitSerialChar(13);
             break;
         default:
-            while(!machine.clearToSend()) 
+            while(!machine.clearToSend() && (g_signal == 0))
             {
                 usleep(1000);  // 1ms sleep
             }
@@ -185,8 +468,17 @@ int main(int argc, char *argv[])
         }
     }
     
-    machine.halt();
+    if (stub)
+    {
+        stub->stop();
+    }
+    else
+    {
+        machine.halt();
+    }
     t1.join();
+    machine.stopRecording();
+    machine.saveProfile();
 
     restoreMode();
 
@@ -0,0 +1,70 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    Check that switching between the HD6309 and MC6809
+    instruction sets drops instructions decoded under the
+    other set: opcode 0x01 is OIM (3 bytes) on the HD6309
+    and the undocumented NEG (2 bytes) on the MC6809.
+
+*/
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "simulator.h"
+
+/** execute the instruction at 0x1000 once, returns the
+    address of the next one */
+static uint16_t runOnce(Simulator &sim, bool hd6309)
+{
+    sim.hd6309(hd6309);
+    sim.reset();
+    sim.step();
+    return sim.pc();
+}
+
+int main()
+{
+    // OIM #$80,<$20 on the HD6309, NEG <$80 on the MC6809
+    static const uint8_t code[] = {0x01, 0x80, 0x20, 0x12, 0x12};
+    static const uint8_t vector[] = {0x10, 0x00};
+
+    Simulator sim;
+    sim.load(0x1000, code, sizeof(code));
+    sim.load(0xFFFE, vector, sizeof(vector));
+
+    struct
+    {
+        bool     hd6309;
+        uint16_t next;
+    } const runs[] =
+    {
+        {true,  0x1003},
+        {false, 0x1002},
+        {true,  0x1003}
+    };
+
+    int failed = 0;
+    for(auto const &run : runs)
+    {
+        uint16_t next = runOnce(sim, run.hd6309);
+        if (next != run.next)
+        {
+            printf("%s: opcode 0x01 ends at %04X, expected %04X\n",
+                run.hd6309 ? "HD6309" : "MC6809", next, run.next);
+            failed = 1;
+        }
+    }
+
+    if (!failed)
+    {
+        printf("mode switches ok\n");
+    }
+    return failed;
+}
@@ -0,0 +1,101 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    Input log for deterministic record and replay: everything
+    the host feeds into a run, keyed by instruction count.
+
+*/
+
+#include <string.h>
+#include "replay.h"
+
+ReplayLog::ReplayLog()
+{
+    m_file = nullptr;
+    m_pos = 0;
+}
+
+ReplayLog::~ReplayLog()
+{
+    close();
+}
+
+bool ReplayLog::create(const std::string &filename, const ReplayHeader &header)
+{
+    close();
+
+    m_file = fopen(filename.c_str(), "wb");
+    if (m_file == nullptr)
+    {
+        return false;
+    }
+
+    ReplayHeader h = header;
+    memcpy(h.magic, REPLAY_MAGIC, sizeof(h.magic));
+    h.version = REPLAY_VERSION;
+    h.eventSize = sizeof(ReplayEvent);
+    fwrite(&h, sizeof(h), 1, m_file);
+    fflush(m_file);
+    return true;
+}
+
+void ReplayLog::append(const ReplayEvent &event)
+{
+    if (m_file == nullptr)
+    {
+        return;
+    }
+
+    fwrite(&event, sizeof(event), 1, m_file);
+    if (event.type != REPLAY_SLEEP)
+    {
+        fflush(m_file);
+    }
+}
+
+void ReplayLog::close()
+{
+    if (m_file != nullptr)
+    {
+        fclose(m_file);
+        m_file = nullptr;
+    }
+}
+
+bool ReplayLog::load(const std::string &filename, ReplayHeader &header)
+{
+    close();
+    m_events.clear();
+    m_pos = 0;
+
+    FILE *fin = fopen(filename.c_str(), "rb");
+    if (fin == nullptr)
+    {
+        return false;
+    }
+
+    if ((fread(&header, sizeof(header), 1, fin) != 1) ||
+        (memcmp(header.magic, REPLAY_MAGIC, sizeof(header.magic)) != 0) ||
+        (header.version != REPLAY_VERSION) ||
+        (header.eventSize != sizeof(ReplayEvent)))
+    {
+        fclose(fin);
+        return false;
+    }
+
+    // a recording cut short by a crash may end in a
+    // partial event, fread() drops it
+    ReplayEvent event;
+    while(fread(&event, sizeof(event), 1, fin) == 1)
+    {
+        m_events.push_back(event);
+    }
+    fclose(fin);
+    return true;
+}
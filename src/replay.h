@@ -0,0 +1,139 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    Input log for deterministic record and replay: everything
+    the host feeds into a run, keyed by instruction count.
+
+*/
+
+#ifndef replay_h
+#define replay_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/** kinds of logged input */
+enum ReplayEventType : uint8_t
+{
+    REPLAY_SERIAL,  ///< value is a character put in the UART
+    REPLAY_SLEEP,   ///< the guest waited, cycles is the count afterwards
+    REPLAY_END      ///< the recording stopped, value is the state hash
+};
+
+/** one input event, in host byte order */
+struct ReplayEvent
+{
+    uint64_t instructions;  ///< instructions executed since the recording started
+    uint64_t cycles;        ///< CPU cycles at the event, or after a sleep
+    uint64_t value;
+    uint8_t  type;          ///< ReplayEventType
+    uint8_t  pad[7];
+};
+
+static_assert(sizeof(ReplayEvent) == 32, "replay events must stay 32 bytes");
+
+/** replay file header, followed by the events */
+struct ReplayHeader
+{
+    char     magic[8];      ///< REPLAY_MAGIC
+    uint32_t version;       ///< REPLAY_VERSION
+    uint32_t eventSize;     ///< sizeof(ReplayEvent)
+    uint64_t stateHash;     ///< machine state when the recording started
+    double   mhz;           ///< CPU clock of the recording, 0 for unthrottled
+};
+
+static constexpr char REPLAY_MAGIC[9] = "HD6309RR";
+static constexpr uint32_t REPLAY_VERSION = 1;
+
+/** writes a replay file as events happen, or reads
+    one back for playback. Without a file, it keeps the
+    events in memory, for going back in time.
+
+    Input is rare next to instructions, so events are
+    written straight through stdio; characters are flushed
+    at once so a crashed run still has its input up to the
+    crash.
+*/
+class ReplayLog
+{
+public:
+    ReplayLog();
+
+    /** closes the file */
+    ~ReplayLog();
+
+    ReplayLog(const ReplayLog&) = delete;
+    ReplayLog& operator=(const ReplayLog&) = delete;
+
+    /** create a file for recording and write the header */
+    bool create(const std::string &filename, const ReplayHeader &header);
+
+    /** recording: add an event */
+    void append(const ReplayEvent &event);
+
+    /** recording: flush and close the file */
+    void close();
+
+    /** read a recorded file for playback, false
+        if it isn't a replay file of this version */
+    bool load(const std::string &filename, ReplayHeader &header);
+
+    /** playback: the next event, nullptr after the last one */
+    const ReplayEvent* next() const
+    {
+        return (m_pos < m_events.size()) ? &m_events[m_pos] : nullptr;
+    }
+
+    /** playback: move on to the following event */
+    void pop()
+    {
+        m_pos++;
+    }
+
+    /** keep an event in memory, as one that has been played */
+    void push(const ReplayEvent &event)
+    {
+        m_events.push_back(event);
+        m_pos = m_events.size();
+    }
+
+    /** index of the next event to play */
+    size_t position() const
+    {
+        return m_pos;
+    }
+
+    /** play from the event at index pos on */
+    void seek(size_t pos)
+    {
+        m_pos = pos;
+    }
+
+    /** forget the events that have not been played */
+    void truncate()
+    {
+        m_events.resize(m_pos);
+    }
+
+    /** forget the first count events */
+    void dropFront(size_t count)
+    {
+        m_events.erase(m_events.begin(), m_events.begin() + count);
+        m_pos -= count;
+    }
+
+protected:
+    FILE *m_file;
+    std::vector<ReplayEvent> m_events;  ///< loaded for playback, or kept in memory
+    size_t m_pos;                       ///< next event to play
+};
+
+#endif
@@ -0,0 +1,79 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    Event scheduler on guest time: devices post callbacks
+    for a future CPU cycle count.
+
+*/
+
+#include <algorithm>
+#include "scheduler.h"
+
+Scheduler::Scheduler(const uint64_t &clock) : m_clock(clock)
+{
+    m_next = NEVER;
+    m_nextId = 1;
+}
+
+Scheduler::EventId Scheduler::at(uint64_t when, Handler handler, void *ctx, uint32_t tag)
+{
+    EventId id = m_nextId++;
+    m_heap.push_back({when, id, handler, ctx, tag, false});
+    std::push_heap(m_heap.begin(), m_heap.end());
+    m_next = m_heap.front().when;
+    return id;
+}
+
+void Scheduler::cancel(EventId id)
+{
+    // events are marked and dropped once they reach the top,
+    // the heap only holds a handful of them
+    for(auto &event : m_heap)
+    {
+        if (event.id == id)
+        {
+            event.cancelled = true;
+            settle();
+            return;
+        }
+    }
+}
+
+size_t Scheduler::pending() const
+{
+    size_t count = 0;
+    for(auto &event : m_heap)
+    {
+        count += event.cancelled ? 0 : 1;
+    }
+    return count;
+}
+
+void Scheduler::settle()
+{
+    while(!m_heap.empty() && m_heap.front().cancelled)
+    {
+        std::pop_heap(m_heap.begin(), m_heap.end());
+        m_heap.pop_back();
+    }
+    m_next = m_heap.empty() ? NEVER : m_heap.front().when;
+}
+
+void Scheduler::run()
+{
+    while(m_next <= m_clock)
+    {
+        std::pop_heap(m_heap.begin(), m_heap.end());
+        Event event = m_heap.back();
+        m_heap.pop_back();
+        settle();
+
+        event.handler(event.ctx, event.tag);
+    }
+}
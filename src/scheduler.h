@@ -0,0 +1,96 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    Event scheduler on guest time: devices post callbacks
+    for a future CPU cycle count.
+
+*/
+
+#ifndef scheduler_h
+#define scheduler_h
+
+#include <stdint.h>
+#include <vector>
+
+/** min-heap of events ordered by CPU cycle.
+
+    The CPU loop compares the cycle count with next() and
+    only calls run() once the earliest deadline is reached.
+    All functions must be called from the CPU thread.
+*/
+class Scheduler
+{
+public:
+    typedef void (*Handler)(void *ctx, uint32_t tag);
+    typedef uint64_t EventId;
+
+    static constexpr uint64_t NEVER = UINT64_MAX;
+
+    /** create a scheduler running on the given cycle counter */
+    Scheduler(const uint64_t &clock);
+
+    /** current guest time in cycles */
+    uint64_t now() const
+    {
+        return m_clock;
+    }
+
+    /** deadline of the earliest event, NEVER if there is none */
+    uint64_t next() const
+    {
+        return m_next;
+    }
+
+    /** call handler(ctx, tag) once the clock reaches when,
+        returns an id for cancel() */
+    EventId at(uint64_t when, Handler handler, void *ctx, uint32_t tag = 0);
+
+    /** call handler(ctx, tag) after delay cycles */
+    EventId after(uint64_t delay, Handler handler, void *ctx, uint32_t tag = 0)
+    {
+        return at(m_clock + delay, handler, ctx, tag);
+    }
+
+    /** drop a pending event, ignored if it has already run */
+    void cancel(EventId id);
+
+    /** number of events that have not run or been cancelled */
+    size_t pending() const;
+
+    /** run all events that are due, in deadline order. Handlers
+        may post or cancel events. */
+    void run();
+
+protected:
+    struct Event
+    {
+        uint64_t when;
+        EventId  id;        ///< also orders events with the same deadline
+        Handler  handler;
+        void    *ctx;
+        uint32_t tag;
+        bool     cancelled;
+
+        bool operator<(const Event &o) const
+        {
+            // std::push_heap keeps the largest on top
+            return (when != o.when) ? (when > o.when) : (id > o.id);
+        }
+    };
+
+    /** drop cancelled events from the top and update m_next */
+    void settle();
+
+    const uint64_t &m_clock;
+    uint64_t m_next;
+    EventId  m_nextId;
+    std::vector<Event> m_heap;
+};
+
+#endif
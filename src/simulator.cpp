@@ -0,0 +1,155 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    Embedding API of libhd6309.
+
+*/
+
+#include "simulator.h"
+#include "machine.h"
+
+Simulator::Simulator() : Simulator(new Machine())
+{
+    // lazy condition codes, as hd6309sim runs by default
+    m_machine->lazy_flags(1);
+}
+
+Simulator::Simulator(Machine *machine) : m_machine(machine)
+{
+    m_machine->setConsole(collect, &m_output);
+}
+
+Simulator::~Simulator()
+{
+    delete m_machine;
+}
+
+bool Simulator::loadHex(const std::string &filename)
+{
+    return m_machine->loadHex(filename);
+}
+
+bool Simulator::loadRom(const std::string &filename)
+{
+    return m_machine->loadRom(filename);
+}
+
+void Simulator::load(uint16_t address, const uint8_t *data, size_t len)
+{
+    m_machine->loadBytes(address, data, len);
+}
+
+bool Simulator::mountDisk(uint8_t drive, const std::string &filename)
+{
+    return m_machine->mountDisk(drive, filename);
+}
+
+bool Simulator::loadState(const std::string &filename)
+{
+    return m_machine->loadState(filename);
+}
+
+bool Simulator::saveState(const std::string &filename)
+{
+    return m_machine->saveState(filename);
+}
+
+void Simulator::reset()
+{
+    m_machine->reset();
+}
+
+void Simulator::hd6309(bool state)
+{
+    m_machine->hd6309(state);
+}
+
+Simulator* Simulator::fork()
+{
+    return new Simulator(m_machine->fork());
+}
+
+void Simulator::input(const std::string &text)
+{
+    m_machine->script(text);
+}
+
+std::string Simulator::output()
+{
+    std::string text;
+    text.swap(m_output);
+    return text;
+}
+
+Simulator::StopReason Simulator::run(uint64_t budget)
+{
+    // an empty script still stops run() at the next prompt
+    m_machine->script(std::string());
+    m_machine->setBudget(budget);
+    m_machine->run();
+
+    switch(m_machine->stopReason())
+    {
+    case Machine::STOP_INVALID:
+        return STOP_INVALID;
+    case Machine::STOP_BUDGET:
+        return STOP_BUDGET;
+    case Machine::STOP_INPUT:
+        return STOP_INPUT;
+    case Machine::STOP_BREAK:
+        return STOP_BREAK;
+    default:
+        return STOP_HALT;
+    }
+}
+
+bool Simulator::addBreakpoint(uint16_t address)
+{
+    return m_machine->addBreakpoint(address);
+}
+
+void Simulator::removeBreakpoint(uint16_t address)
+{
+    m_machine->removeBreakpoint(address);
+}
+
+bool Simulator::addWatchpoint(uint16_t address, WatchKind kind, int value)
+{
+    return m_machine->addWatchpoint(address, static_cast<Machine::WatchKind>(kind), value);
+}
+
+void Simulator::removeWatchpoint(uint16_t address, WatchKind kind)
+{
+    m_machine->removeWatchpoint(address, static_cast<Machine::WatchKind>(kind));
+}
+
+void Simulator::step()
+{
+    m_machine->step();
+}
+
+uint64_t Simulator::cycles() const
+{
+    return m_machine->get_cycles();
+}
+
+uint64_t Simulator::instructions() const
+{
+    return m_machine->instructions();
+}
+
+uint16_t Simulator::pc() const
+{
+    return m_machine->get_pc();
+}
+
+void Simulator::collect(void *ctx, uint8_t c)
+{
+    static_cast<std::string*>(ctx)->push_back(static_cast<char>(c));
+}
@@ -0,0 +1,136 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    Embedding API of libhd6309. This header does not depend
+    on the CPU core, so programs that link the library only
+    need this file.
+
+*/
+
+#ifndef simulator_h
+#define simulator_h
+
+#include <stdint.h>
+#include <string>
+
+class Machine;
+
+/** an HD6309 computer that runs on the caller's thread.
+
+    A typical test boots or loads a snapshot, then alternates
+    input() and run() and checks output():
+
+        Simulator sim;
+        sim.loadState("flex.state");
+        sim.input("dir\r");
+        sim.run(100000000);
+        std::string text = sim.output();
+
+    All functions must be called from the same thread.
+*/
+class Simulator
+{
+public:
+    /** why run() returned */
+    enum StopReason
+    {
+        STOP_HALT,      ///< the machine was halted
+        STOP_INVALID,   ///< the guest ran an illegal instruction
+        STOP_BUDGET,    ///< the cycle budget ran out
+        STOP_INPUT,     ///< the guest waits for more input
+        STOP_BREAK      ///< a breakpoint or watchpoint was hit
+    };
+
+    enum WatchKind
+    {
+        WATCH_READ   = 0x01,
+        WATCH_WRITE  = 0x02,
+        WATCH_ACCESS = 0x03
+    };
+
+    Simulator();
+    ~Simulator();
+
+    Simulator(const Simulator&) = delete;
+    Simulator& operator=(const Simulator&) = delete;
+
+    /** load a HEX file into RAM or ROM */
+    bool loadHex(const std::string &filename);
+
+    /** load a 4k binary ROM file into 0xF000 .. 0xFFFF */
+    bool loadRom(const std::string &filename);
+
+    /** copy bytes into RAM (below 0xE000) or ROM (0xF000 and up) */
+    void load(uint16_t address, const uint8_t *data, size_t len);
+
+    /** mount a DSK file as drive 0 .. 3 */
+    bool mountDisk(uint8_t drive, const std::string &filename);
+
+    /** restore a snapshot, replaces loading and reset() */
+    bool loadState(const std::string &filename);
+
+    /** write a snapshot of the current state */
+    bool saveState(const std::string &filename);
+
+    /** reset the CPU, after loading the ROM */
+    void reset();
+
+    /** select the HD6309 (default) or MC6809 instruction set */
+    void hd6309(bool state);
+
+    /** a copy that continues from the current state, sharing
+        memory and disks until either one writes to them */
+    Simulator* fork();
+
+    /** queue characters for the UART, one is delivered each
+        time the guest waits for input */
+    void input(const std::string &text);
+
+    /** return and clear what the guest sent to the UART */
+    std::string output();
+
+    /** run until the guest waits for input once all queued
+        input is used up, or for at most budget cycles if that
+        is not 0 */
+    StopReason run(uint64_t budget = 0);
+
+    /** stop run() before the instruction at address, in all
+        RAM banks for addresses below 0x8000. The next run()
+        or step() executes it. */
+    bool addBreakpoint(uint16_t address);
+    void removeBreakpoint(uint16_t address);
+
+    /** stop run() after an instruction that accesses address,
+        only for this value if it isn't negative */
+    bool addWatchpoint(uint16_t address, WatchKind kind, int value = -1);
+    void removeWatchpoint(uint16_t address, WatchKind kind);
+
+    /** execute a single instruction */
+    void step();
+
+    /** cycles since power on */
+    uint64_t cycles() const;
+
+    /** instructions executed since the simulator was created */
+    uint64_t instructions() const;
+
+    /** address of the next instruction */
+    uint16_t pc() const;
+
+protected:
+    Simulator(Machine *machine);
+
+    /** UART output handler, appends to m_output */
+    static void collect(void *ctx, uint8_t c);
+
+    Machine     *m_machine;
+    std::string m_output;
+};
+
+#endif
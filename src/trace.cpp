@@ -0,0 +1,111 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    Binary instruction trace: the CPU thread fills a ring
+    buffer that a background thread streams to a file.
+
+*/
+
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include "trace.h"
+
+TraceWriter::TraceWriter()
+{
+    m_head = 0;
+    m_tailCache = 0;
+    m_published = 0;
+    m_consumed = 0;
+    m_stop = false;
+    m_file = nullptr;
+}
+
+TraceWriter::~TraceWriter()
+{
+    close();
+}
+
+bool TraceWriter::open(const std::string &filename)
+{
+    close();
+
+    m_file = fopen(filename.c_str(), "wb");
+    if (m_file == nullptr)
+    {
+        return false;
+    }
+
+    TraceHeader header = {};
+    memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_VERSION;
+    header.recordSize = sizeof(TraceRecord);
+    fwrite(&header, sizeof(header), 1, m_file);
+
+    m_ring.resize(SIZE);
+    m_head = 0;
+    m_tailCache = 0;
+    m_published = 0;
+    m_consumed = 0;
+    m_stop = false;
+    m_thread = std::thread(&TraceWriter::writer, this);
+    return true;
+}
+
+void TraceWriter::close()
+{
+    if (m_file == nullptr)
+    {
+        return;
+    }
+
+    flush();
+    m_stop.store(true, std::memory_order_release);
+    m_thread.join();
+    fclose(m_file);
+    m_file = nullptr;
+}
+
+void TraceWriter::waitForSpace()
+{
+    flush();
+    while((m_head - (m_tailCache = m_consumed.load(std::memory_order_acquire))) == SIZE)
+    {
+        std::this_thread::yield();
+    }
+}
+
+void TraceWriter::writer()
+{
+    uint64_t tail = 0;
+    while(true)
+    {
+        // read the stop flag first: once it is seen,
+        // every record committed before it is visible
+        bool stop = m_stop.load(std::memory_order_acquire);
+        uint64_t head = m_published.load(std::memory_order_acquire);
+        if (head == tail)
+        {
+            if (stop)
+            {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            continue;
+        }
+
+        // write up to the end of the ring, the rest goes next time
+        uint64_t start = tail & (SIZE - 1);
+        uint64_t count = std::min(std::min(head - tail, SIZE - start), CHUNK);
+        fwrite(&m_ring[start], sizeof(TraceRecord), count, m_file);
+        tail += count;
+        m_consumed.store(tail, std::memory_order_release);
+    }
+    fflush(m_file);
+}
@@ -0,0 +1,144 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    Binary instruction trace: the CPU thread fills a ring
+    buffer that a background thread streams to a file.
+
+*/
+
+#ifndef trace_h
+#define trace_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+
+/** one executed instruction, in host byte order.
+    The registers are those after the instruction. */
+struct TraceRecord
+{
+    uint64_t cycles;        ///< cycles since power on, after the instruction
+    uint16_t pc;            ///< address of the instruction
+    uint16_t ea;            ///< effective address, if TRACE_EA is set
+    uint16_t d, w, x, y;
+    uint16_t u, s, v;
+    uint8_t  bytes[5];      ///< opcode and operand bytes
+    uint8_t  len;           ///< number of valid bytes, 0 if unknown
+    uint8_t  cc;
+    uint8_t  dp;
+    uint8_t  md;
+    uint8_t  value;         ///< memory at ea, if TRACE_VALUE is set
+    uint8_t  flags;
+    uint8_t  pagereg;       ///< RAM bank selected for 0x0000 .. 0x7FFF
+    uint8_t  pad[2];
+};
+
+static_assert(sizeof(TraceRecord) == 40, "trace records must stay 40 bytes");
+
+enum TraceFlags : uint8_t
+{
+    TRACE_EA    = 0x01,     ///< the instruction has a memory operand at ea
+    TRACE_VALUE = 0x02      ///< ea is RAM or ROM, value holds its contents
+};
+
+/** trace file header, followed by the records */
+struct TraceHeader
+{
+    char     magic[8];      ///< TRACE_MAGIC
+    uint32_t version;       ///< TRACE_VERSION
+    uint32_t recordSize;    ///< sizeof(TraceRecord)
+};
+
+static constexpr char TRACE_MAGIC[9] = "HD6309TR";
+static constexpr uint32_t TRACE_VERSION = 1;
+
+/** streams trace records to a file.
+
+    Like the Mailbox, the ring is a lock-free single-producer/
+    single-consumer queue, but the writer thread drains it in
+    large blocks. The producer, the CPU thread, waits when the
+    ring is full, so no records are lost.
+*/
+class TraceWriter
+{
+public:
+    TraceWriter();
+
+    /** flushes and closes the file */
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    /** create the file and start the writer thread */
+    bool open(const std::string &filename);
+
+    /** write out all records and close the file, call it
+        from the producer or once the producer has stopped */
+    void close();
+
+    /** producer: slot for the next record, publish it with commit() */
+    TraceRecord& next()
+    {
+        if ((m_head - m_tailCache) == SIZE)
+        {
+            waitForSpace();
+        }
+        return m_ring[m_head & (SIZE - 1)];
+    }
+
+    /** producer: hand the record returned by next() to the
+        writer. Records are published in groups, so the writer
+        doesn't pull the counter's cache line for every one. */
+    void commit()
+    {
+        m_head++;
+        if ((m_head & (PUBLISH - 1)) == 0)
+        {
+            m_published.store(m_head, std::memory_order_release);
+        }
+    }
+
+    /** producer: publish the records committed so far */
+    void flush()
+    {
+        m_published.store(m_head, std::memory_order_release);
+    }
+
+    /** records written so far */
+    uint64_t records() const
+    {
+        return m_consumed.load(std::memory_order_acquire);
+    }
+
+protected:
+    static constexpr uint64_t SIZE  = 1 << 20;     ///< records in the ring, a power of two
+    static constexpr uint64_t CHUNK = 1 << 14;     ///< most records per fwrite()
+    static constexpr uint64_t PUBLISH = 256;        ///< records per m_published update
+
+    /** producer: wait until the writer has made room */
+    void waitForSpace();
+
+    /** writer thread main loop */
+    void writer();
+
+    std::vector<TraceRecord> m_ring;
+    uint64_t m_head;        ///< next record to fill, producer only
+    uint64_t m_tailCache;   ///< m_consumed as last seen by the producer
+    alignas(64) std::atomic<uint64_t> m_published;  ///< written by the producer
+    alignas(64) std::atomic<uint64_t> m_consumed;   ///< written by the writer
+    alignas(64) std::atomic<bool> m_stop;
+    std::thread m_thread;
+    FILE *m_file;
+};
+
+#endif
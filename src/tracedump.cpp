@@ -0,0 +1,153 @@
+/*
+
+    Simulator for the HD6309 computer
+    Copyright N.A. Moseley 2019
+
+    www.moseleyinstruments.com
+
+    namoseley.wordpress.com
+
+    Offline decoder for the binary trace files written
+    by hd6309sim --trace.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <string>
+#include <iostream>
+
+#include "cxxopts.hpp"
+
+#include "trace.h"
+#include "disasm.h"
+
+/** condition codes as EFHINZVC, with '.' for clear bits */
+static void ccString(uint8_t cc, char *text)
+{
+    static const char names[] = "EFHINZVC";
+    for(uint32_t bit=0; bit<8; bit++)
+    {
+        text[bit] = (cc & (0x80 >> bit)) ? names[bit] : '.';
+    }
+    text[8] = 0;
+}
+
+static void printRecord(const TraceRecord &rec, bool is6309)
+{
+    char bytes[16];
+    char *p = bytes;
+    for(uint32_t i=0; i<sizeof(rec.bytes); i++)
+    {
+        if (i < rec.len)
+        {
+            p += sprintf(p, "%02X", rec.bytes[i]);
+        }
+        else
+        {
+            p += sprintf(p, "  ");
+        }
+    }
+
+    char text[48];
+    disassemble(is6309, rec.pc, rec.bytes, rec.len, text, sizeof(text));
+
+    char cc[9];
+    ccString(rec.cc, cc);
+
+    printf("%12llu %04X %s  %-20s A:%02X B:%02X E:%02X F:%02X X:%04X Y:%04X U:%04X S:%04X DP:%02X %s",
+        static_cast<unsigned long long>(rec.cycles), rec.pc, bytes, text,
+        rec.d >> 8, rec.d & 0xFF, rec.w >> 8, rec.w & 0xFF,
+        rec.x, rec.y, rec.u, rec.s, rec.dp, cc);
+
+    if (rec.flags & TRACE_EA)
+    {
+        printf("  [%04X]", rec.ea);
+        if (rec.flags & TRACE_VALUE)
+        {
+            printf("=%02X", rec.value);
+        }
+    }
+    printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+    cxxopts::Options options("hd6309trace", "Print a trace file written by hd6309sim --trace");
+
+    std::string filename;
+    uint64_t skip = 0;
+    uint64_t count = UINT64_MAX;
+    int32_t onlyPC = -1;
+    bool mc6809 = false;
+
+    options.positional_help("FILE");
+    options.add_options()
+        ("trace", "Trace file", cxxopts::value<std::string>(filename))
+        ("skip", "Skip the first N records", cxxopts::value<uint64_t>(skip))
+        ("count", "Print at most N records", cxxopts::value<uint64_t>(count))
+        ("pc", "Only print instructions at this HEX address", cxxopts::value<std::string>())
+        ("mc6809", "Disassemble MC6809 instead of HD6309 opcodes", cxxopts::value<bool>(mc6809))
+        ("help", "Print help")
+    ;
+    options.parse_positional({"trace"});
+
+    try
+    {
+        auto result = options.parse(argc, argv);
+        if (result.count("help") || filename.empty())
+        {
+            std::cout << options.help({""}) << std::endl;
+            return 0;
+        }
+        if (result.count("pc"))
+        {
+            onlyPC = (int32_t)strtol(result["pc"].as<std::string>().c_str(), NULL, 16);
+        }
+    }
+    catch(...)
+    {
+        return -1;
+    }
+
+    FILE *fin = fopen(filename.c_str(), "rb");
+    if (fin == nullptr)
+    {
+        printf("Cannot open %s\n", filename.c_str());
+        return 1;
+    }
+
+    TraceHeader header;
+    if ((fread(&header, sizeof(header), 1, fin) != 1) ||
+        (memcmp(header.magic, TRACE_MAGIC, sizeof(header.magic)) != 0) ||
+        (header.version != TRACE_VERSION) ||
+        (header.recordSize != sizeof(TraceRecord)))
+    {
+        printf("%s is not a trace file of this version\n", filename.c_str());
+        fclose(fin);
+        return 1;
+    }
+
+    // a trace cut short by a crash may end in a partial record,
+    // fread() drops it
+    static TraceRecord records[4096];
+    uint64_t index = 0;
+    uint64_t printed = 0;
+    size_t n;
+    while((printed < count) && ((n = fread(records, sizeof(TraceRecord), 4096, fin)) > 0))
+    {
+        for(size_t i=0; (i<n) && (printed < count); i++, index++)
+        {
+            if ((index < skip) || ((onlyPC >= 0) && (records[i].pc != onlyPC)))
+            {
+                continue;
+            }
+            printRecord(records[i], !mc6809);
+            printed++;
+        }
+    }
+    fclose(fin);
+    return 0;
+}
@@ -14,9 +14,19 @@
 #include <stdio.h>
 #include "uart.h"
 
-UART::UART()
+UART::UART(Scheduler &scheduler) : m_scheduler(scheduler)
 {
+    m_output = nullptr;
+    m_outputCtx = nullptr;
+    m_mute = false;
+    m_txEvent = 0;
+    m_txEnd = 0;
+    m_cpuHz = XTAL_HZ;
+    m_dll = 1;
+    m_dlm = 0;
     m_lcr = 0;
+    m_ier = 0;
+    m_serialInputBuffer = 0;
     m_status = 0;
     m_status |= 32; // transmit holding empty
     m_status |= 64; // transmit empty
@@ -33,12 +43,43 @@ void UART::write(uint8_t reg, uint8_t value)
     case 0: // transmit hold register or DLL register
         if (m_lcr & 0x80)
         {
-            // DLL register
+            m_dll = value;
         }
         else
         {
-            printf("%c", value);
-            fflush(stdout);
+            if (!m_mute)
+            {
+                if (m_output != nullptr)
+                {
+                    m_output(m_outputCtx, value);
+                }
+                else
+                {
+                    printf("%c", value);
+                    fflush(stdout);
+                }
+            }
+
+            // the holding register stays full until the
+            // character has been shifted out
+            uint64_t start = (m_txEnd > m_scheduler.now()) ? m_txEnd : m_scheduler.now();
+            m_txEnd = start + charCycles();
+            if (m_txEvent != 0)
+            {
+                m_scheduler.cancel(m_txEvent);
+            }
+            m_txEvent = m_scheduler.at(m_txEnd, txDone, this);
+            m_status &= ~(32 | 64);
+        }
+        break;
+    case 1: // IER register or DLM register
+        if (m_lcr & 0x80)
+        {
+            m_dlm = value;
+        }
+        else
+        {
+            m_ier = value & 0x0F;
         }
         break;
     case 3: // LCR register
@@ -52,6 +93,59 @@ void UART::write(uint8_t reg, uint8_t value)
     }
 }
 
+uint64_t UART::charCycles() const
+{
+    uint32_t bits = 1 + 5 + (m_lcr & 3);   // start and data bits
+    bits += (m_lcr & 8) ? 1 : 0;            // parity
+    bits += (m_lcr & 4) ? 2 : 1;            // stop bits
+    uint32_t divisor = (static_cast<uint32_t>(m_dlm) << 8) | m_dll;
+    if (divisor == 0)
+    {
+        divisor = 1;
+    }
+    return static_cast<uint64_t>(bits * 16.0 * divisor * m_cpuHz / XTAL_HZ);
+}
+
+void UART::txDone(void *ctx, uint32_t /*tag*/)
+{
+    UART *uart = static_cast<UART*>(ctx);
+    uart->m_txEvent = 0;
+    uart->m_status |= 32 | 64;  // transmit holding and shift register empty
+}
+
+void UART::getState(State &state) const
+{
+    state = {};
+    state.txEnd  = m_txEnd;
+    state.rx     = m_serialInputBuffer;
+    state.status = m_status;
+    state.lcr    = m_lcr;
+    state.ier    = m_ier;
+    state.dll    = m_dll;
+    state.dlm    = m_dlm;
+}
+
+void UART::setState(const State &state)
+{
+    m_txEnd = state.txEnd;
+    m_serialInputBuffer = state.rx;
+    m_status = state.status;
+    m_lcr = state.lcr;
+    m_ier = state.ier;
+    m_dll = state.dll;
+    m_dlm = state.dlm;
+
+    if (m_txEvent != 0)
+    {
+        m_scheduler.cancel(m_txEvent);
+        m_txEvent = 0;
+    }
+    if ((m_status & 32) == 0)
+    {
+        m_txEvent = m_scheduler.at(m_txEnd, txDone, this);
+    }
+}
+
 bool UART::clearToSend() const
 {
     return (m_status & 1) == 0;
@@ -68,6 +162,10 @@ uint8_t UART::read(uint8_t reg)
     case 0: // receive holding register
         m_status &= ~1; // set serial data ready to zero.
         return m_serialInputBuffer;
+    case 1: // IER register
+        return m_ier;
+    case 2: // IIR register
+        return irq() ? 0x04 : 0x01;
     case 3: // LCR register
         return m_lcr;
     case 5: // LSR register
@@ -16,11 +16,37 @@
 
 //#define DEBUGGING
 #include <stdint.h>
+#include "scheduler.h"
 
 class UART
 {
 public:
-    UART();
+    typedef void (*OutputHandler)(void *ctx, uint8_t c);
+
+    /** the UART times its transmitter on the CPU clock
+        through the scheduler */
+    UART(Scheduler &scheduler);
+
+    /** send transmitted characters to handler instead of
+        stdout, nullptr restores stdout */
+    void setOutput(OutputHandler handler, void *ctx)
+    {
+        m_output = handler;
+        m_outputCtx = ctx;
+    }
+
+    /** drop transmitted characters, e.g. while the machine
+        executes again what it has already done */
+    void mute(bool state)
+    {
+        m_mute = state;
+    }
+
+    /** set the CPU clock in Hz that scheduler cycles run at */
+    void setCpuClock(double hz)
+    {
+        m_cpuHz = hz;
+    }
 
     /** submit a serial character from a console */
     void submitSerialChar(uint8_t c);
@@ -31,10 +57,57 @@ public:
     void    write(uint8_t reg, uint8_t value);
     uint8_t read(uint8_t reg);
 
+    /** returns true if the UART asserts its interrupt output,
+        only the receive data interrupt is modelled */
+    bool irq() const
+    {
+        return (m_ier & 1) && (m_status & 1);
+    }
+
+    /** register state for snapshots */
+    struct State
+    {
+        uint64_t txEnd;     ///< cycle at which the transmitter is idle
+        uint8_t  rx;        ///< receive holding register
+        uint8_t  status;
+        uint8_t  lcr;
+        uint8_t  ier;
+        uint8_t  dll;
+        uint8_t  dlm;
+        uint8_t  pad[2];
+    };
+
+    void getState(State &state) const;
+
+    /** restore the registers, a character that is still
+        being sent finishes at the saved cycle */
+    void setState(const State &state);
+
 protected:
+    /** CPU cycles to shift out one character at the programmed
+        divisor and format, for a 1.8432 MHz UART crystal */
+    uint64_t charCycles() const;
+
+    /** scheduler callback: the transmitter has finished */
+    static void txDone(void *ctx, uint32_t tag);
+
+    static constexpr double XTAL_HZ = 1843200.0;
+
+    OutputHandler m_output;
+    void *m_outputCtx;
+    bool m_mute;
+
+    Scheduler &m_scheduler;
+    Scheduler::EventId m_txEvent;   ///< pending txDone, 0 if idle
+    uint64_t m_txEnd;               ///< cycle at which the transmitter is idle
+    double  m_cpuHz;
+
     uint8_t m_serialInputBuffer;
     uint8_t m_status;
     uint8_t m_lcr;
+    uint8_t m_ier;
+    uint8_t m_dll;
+    uint8_t m_dlm;
 };
 
 #endif
\ No newline at end of file